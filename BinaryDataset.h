@@ -0,0 +1,154 @@
+#ifndef BINARY_DATASET_H
+#define BINARY_DATASET_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "DataTypeHandling.h"
+#include "Dataset.h"
+#include "DatasetLoader.h"
+
+using namespace std;
+
+/**
+ * @brief  Header of the binary data set format. The file layout is
+ *
+ *      [BinaryDatasetHeader][N squared row norms][padding][N x D row-major data]
+ *
+ *  Norms and data are stored with the element type given by `dtype' (the size of
+ *  the type in bytes, 4 for float32 and 8 for float64) in host byte order. The data
+ *  section starts at `data_offset', which is a multiple of BINARY_DATASET_ALIGNMENT,
+ *  so rows can be used in-place after mapping the file.
+ */
+struct BinaryDatasetHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint64_t N;
+    uint64_t D;
+    uint64_t norms_offset;
+    uint64_t data_offset;
+};
+
+static constexpr char BINARY_DATASET_MAGIC[8] = { 'S', 'U', 'B', 'M', 'O', 'D', 'D', 'S' };
+static constexpr uint32_t BINARY_DATASET_VERSION = 1;
+static constexpr uint64_t BINARY_DATASET_ALIGNMENT = 64;
+
+/**
+ * @brief  Writes a data set in the binary format, see BinaryDatasetHeader.
+ * @param  path: The output file.
+ * @param  X: The data set to be written.
+ * @retval None
+ */
+inline void save_binary_dataset(string const& path, DatasetView const& X) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("save_binary_dataset: Could not open " + path);
+    }
+
+    BinaryDatasetHeader header;
+    memcpy(header.magic, BINARY_DATASET_MAGIC, sizeof(header.magic));
+    header.version = BINARY_DATASET_VERSION;
+    header.dtype = sizeof(data_t);
+    header.N = X.size();
+    header.D = X.dimension();
+    header.norms_offset = sizeof(BinaryDatasetHeader);
+    uint64_t norms_end = header.norms_offset + header.N * sizeof(data_t);
+    header.data_offset = (norms_end + BINARY_DATASET_ALIGNMENT - 1) / BINARY_DATASET_ALIGNMENT * BINARY_DATASET_ALIGNMENT;
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    vector<data_t> norms(X.size());
+    for (size_t i = 0; i < X.size(); ++i) {
+        data_t n = 0;
+        for (size_t d = 0; d < X.dimension(); ++d) {
+            n += X.row(i)[d] * X.row(i)[d];
+        }
+        norms[i] = n;
+    }
+    out.write(reinterpret_cast<char const*>(norms.data()), norms.size() * sizeof(data_t));
+
+    vector<char> padding(header.data_offset - norms_end, 0);
+    out.write(padding.data(), padding.size());
+
+    for (size_t i = 0; i < X.size(); ++i) {
+        out.write(reinterpret_cast<char const*>(X.row(i)), X.dimension() * sizeof(data_t));
+    }
+
+    if (!out) {
+        throw runtime_error("save_binary_dataset: Could not write " + path);
+    }
+}
+
+/**
+ * @brief  Converts an ARFF file into the binary format.
+ * @param  arff_path: The ARFF file to be read.
+ * @param  binary_path: The binary file to be written.
+ * @param  options: Column selection and threading, see DatasetLoaderOptions.
+ * @retval None
+ */
+inline void convert_arff_to_binary(string const& arff_path, string const& binary_path,
+    DatasetLoaderOptions const& options = DatasetLoaderOptions()) {
+    Dataset X = load_arff(arff_path, options);
+    save_binary_dataset(binary_path, X.view());
+}
+
+/**
+ * @brief  A binary data set which is memory-mapped read-only. Opening the file only
+        validates the header, rows are paged in lazily on first access and the page
+        cache is shared with every other process mapping the same file. Use `view'
+        to hand the rows to an optimizer without copying the data set.
+ */
+class MappedDataset {
+private:
+    unique_ptr<MemoryMappedFile> file;
+    BinaryDatasetHeader header;
+
+public:
+    explicit MappedDataset(string const& path) : file(new MemoryMappedFile(path)) {
+        if (file->size() < sizeof(BinaryDatasetHeader)) {
+            throw runtime_error("MappedDataset: " + path + " is too small to be a binary data set.");
+        }
+        memcpy(&header, file->data(), sizeof(header));
+
+        if (memcmp(header.magic, BINARY_DATASET_MAGIC, sizeof(header.magic)) != 0) {
+            throw runtime_error("MappedDataset: " + path + " is not a binary data set.");
+        }
+        if (header.version != BINARY_DATASET_VERSION) {
+            throw runtime_error("MappedDataset: Unsupported version " + to_string(header.version) + " in " + path);
+        }
+        if (header.dtype != sizeof(data_t)) {
+            throw runtime_error("MappedDataset: " + path + " stores " + to_string(8 * header.dtype)
+                + " bit values, but data_t has " + to_string(8 * sizeof(data_t))
+                + " bits. Convert the data set again with this build.");
+        }
+        if (header.data_offset % BINARY_DATASET_ALIGNMENT != 0
+            || file->size() < header.data_offset + header.N * header.D * sizeof(data_t)
+            || file->size() < header.norms_offset + header.N * sizeof(data_t)) {
+            throw runtime_error("MappedDataset: " + path + " is truncated or corrupt.");
+        }
+    }
+
+    // Number of rows
+    inline size_t size() const { return header.N; }
+
+    // Number of columns
+    inline size_t dimension() const { return header.D; }
+
+    inline data_t const* row(size_t i) const {
+        return reinterpret_cast<data_t const*>(file->data() + header.data_offset) + i * header.D;
+    }
+
+    // The squared L2 norm of row i
+    inline data_t norm(size_t i) const {
+        return reinterpret_cast<data_t const*>(file->data() + header.norms_offset)[i];
+    }
+
+    inline DatasetView view() const { return DatasetView(row(0), header.N, header.D); }
+};
+
+#endif // BINARY_DATASET_H
@@ -0,0 +1,214 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "DataTypeHandling.h"
+#include "Serialization.h"
+#include "SubmodularOptimizer.h"
+
+using namespace std;
+
+/*
+* Checkpoint file layout:
+*
+*      [magic "SUBMODCK"][version][sizeof(data_t)][sizeof(accum_t)][sizeof(idx_t)]
+*      [record]*
+*
+* where every record is
+*
+*      [kind (uint8)][payload length (uint64)][payload][FNV-1a hash of the payload (uint64)]
+*
+* The first record is a full snapshot (SubmodularOptimizer::save(out, false)), every
+* following record is a delta (SubmodularOptimizer::save(out, true)) on top of the
+* previous one. A record which was only partially written, e.g. because the process
+* died during a checkpoint, is detected by its length / hash and ignored on restore.
+*/
+
+static constexpr char CHECKPOINT_MAGIC[8] = { 'S', 'U', 'B', 'M', 'O', 'D', 'C', 'K' };
+static constexpr uint32_t CHECKPOINT_VERSION = 4;
+
+enum class CheckpointRecord : uint8_t { full = 0, delta = 1 };
+
+inline uint64_t fnv1a(string const& bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Replaces `to' by `from' in one step, so that a crash leaves either the old or the new file
+inline bool replace_file(string const& from, string const& to) {
+#ifdef _WIN32
+    // rename fails on Windows if `to' exists
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+/**
+ * @brief  Periodically checkpoints an optimizer into an append-only file. Every call of
+        checkpoint() appends the changes since the previous call, which for the sieve
+        based optimizers are just the newly accepted elements and their Cholesky rows.
+        Checkpointing therefore costs O(changes) and not O(state), so it can be done
+        every few seconds in between two calls of next(). Every `full_every'
+        checkpoints the file is compacted: a full snapshot is written to a temporary
+        file which then replaces the log.
+        Use restore_checkpoint() to load the latest state after a restart.
+ */
+class Checkpointer {
+private:
+    SubmodularOptimizer& opt;
+    string path;
+    size_t full_every;
+    size_t since_full = 0;
+    ofstream log;
+    uint64_t bytes = 0;
+
+    static void write_header(ostream& out) {
+        BinaryWriter writer(out);
+        writer.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        writer.write<uint32_t>(CHECKPOINT_VERSION);
+        writer.write<uint32_t>(sizeof(data_t));
+        writer.write<uint32_t>(sizeof(accum_t));
+        writer.write<uint32_t>(sizeof(idx_t));
+    }
+
+    void write_record(ostream& out, CheckpointRecord kind, string const& payload) {
+        BinaryWriter writer(out);
+        writer.write<uint8_t>(static_cast<uint8_t>(kind));
+        writer.write<uint64_t>(payload.size());
+        writer.write(payload.data(), payload.size());
+        writer.write<uint64_t>(fnv1a(payload));
+        out.flush();
+        if (!out) {
+            // The optimizer already considers this delta written, so start over with a full snapshot
+            log.close();
+            throw runtime_error("Checkpointer: Could not write to " + path);
+        }
+        bytes += payload.size() + sizeof(uint8_t) + 2 * sizeof(uint64_t);
+    }
+
+    void write_full() {
+        ostringstream payload;
+        BinaryWriter writer(payload);
+        opt.save(writer, false);
+
+        log.close();
+        string tmp = path + ".tmp";
+        {
+            ofstream out(tmp, ios::binary | ios::trunc);
+            if (!out) {
+                throw runtime_error("Checkpointer: Could not open " + tmp);
+            }
+            write_header(out);
+            write_record(out, CheckpointRecord::full, payload.str());
+        }
+        if (!replace_file(tmp, path)) {
+            throw runtime_error("Checkpointer: Could not rename " + tmp + " to " + path);
+        }
+
+        log.open(path, ios::binary | ios::app);
+        since_full = 0;
+    }
+
+public:
+    /**
+     * @brief  Creates a new checkpointer. The first call of checkpoint() writes a full
+            snapshot, an existing file at `path' is replaced at that point.
+     * @param  opt: The optimizer to be checkpointed.
+     * @param  path: The checkpoint file.
+     * @param  full_every: Number of deltas after which the log is compacted.
+     */
+    Checkpointer(SubmodularOptimizer& opt, string const& path, size_t full_every = 64)
+        : opt(opt), path(path), full_every(full_every) {}
+
+    // Writes a checkpoint of the current state of the optimizer
+    void checkpoint() {
+        if (!log.is_open() || since_full >= full_every) {
+            write_full();
+        }
+        else {
+            ostringstream payload;
+            BinaryWriter writer(payload);
+            opt.save(writer, true);
+            write_record(log, CheckpointRecord::delta, payload.str());
+            ++since_full;
+        }
+    }
+
+    // Total number of bytes written so far
+    inline uint64_t bytes_written() const { return bytes; }
+};
+
+/**
+ * @brief  Restores the latest complete state from a checkpoint file written by
+        Checkpointer. A trailing record which was not written completely is ignored.
+ * @param  opt: The optimizer to be restored. It must be constructed with the same
+        parameters as the checkpointed one.
+ * @param  path: The checkpoint file.
+ * @retval The number of applied records.
+ */
+inline size_t restore_checkpoint(SubmodularOptimizer& opt, string const& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("restore_checkpoint: Could not open " + path);
+    }
+    BinaryReader reader(in);
+
+    char magic[8];
+    reader.read(magic, sizeof(magic));
+    if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || reader.read<uint32_t>() != CHECKPOINT_VERSION) {
+        throw runtime_error("restore_checkpoint: " + path + " is not a checkpoint file.");
+    }
+    if (reader.read<uint32_t>() != sizeof(data_t) || reader.read<uint32_t>() != sizeof(accum_t)
+        || reader.read<uint32_t>() != sizeof(idx_t)) {
+        throw runtime_error("restore_checkpoint: " + path + " was written by a build with different data types (see SUBMODULAR_SINGLE_PRECISION).");
+    }
+
+    streamoff begin = in.tellg();
+    in.seekg(0, ios::end);
+    streamoff end = in.tellg();
+    in.seekg(begin);
+
+    size_t applied = 0;
+    while (end - in.tellg() >= static_cast<streamoff>(sizeof(uint8_t) + 2 * sizeof(uint64_t))) {
+        uint8_t kind = reader.read<uint8_t>();
+        uint64_t length = reader.read<uint64_t>();
+        if (length > static_cast<uint64_t>(end - in.tellg()) - sizeof(uint64_t)) {
+            // Truncated record
+            break;
+        }
+        string payload(length, '\0');
+        reader.read(&payload[0], payload.size());
+        if (reader.read<uint64_t>() != fnv1a(payload)) break;
+
+        if (applied == 0 && kind != static_cast<uint8_t>(CheckpointRecord::full)) {
+            throw runtime_error("restore_checkpoint: " + path + " does not start with a full snapshot.");
+        }
+
+        istringstream record(payload);
+        BinaryReader record_reader(record);
+        opt.load(record_reader);
+        ++applied;
+    }
+    return applied;
+}
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,486 @@
+#ifndef CONCURRENT_INGESTOR_H
+#define CONCURRENT_INGESTOR_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <optional>
+#include <cstdint>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "DataTypeHandling.h"
+#include "SubmodularOptimizer.h"
+#include "FanOut.h"
+#include "RingBuffer.h"
+
+using namespace std;
+
+/**
+ * @brief  Thread-safe front-end which lets many producer threads (e.g. network readers)
+        feed a single streaming optimizer. SubmodularOptimizer::next is not
+        synchronized, and guarding it with a mutex serializes the producers behind
+        every peek / update of the optimizer. Here producers only copy their element
+        into a bounded lock-free MPSCRingBuffer. A single consumer thread drains the
+        buffer in batches and passes the elements to the optimizer's next(), so the
+        optimizer still sees one sequential stream (in the order the producers
+        claimed their slots).
+
+        Producers never wait for the optimizer. If the buffer is full, try_push()
+        fails immediately, which is the backpressure signal: the producer can retry,
+        drop the element or slow down its source. is_congested() reports a filled
+        buffer before it is full. push() is the convenience variant which retries
+        until there is space.
+
+        To spread the optimizer work itself over several threads, an ingestor can
+        feed a FanOut instead, which runs its optimizers on its own worker pool.
+
+        If the input rate exceeds what the optimizer can process, the buffer fills
+        up and producers are pushed back. With load shedding enabled (see
+        enable_load_shedding) the consumer instead subsamples the stream: it keeps
+        every element with probability p and adapts p to the measured cost per
+        element and the queue depth, so that the backlog can be processed within
+        a given delay. Once the load drops, p goes back to 1.
+
+        While there is nothing to do, the consumer and waiting producers spin for a
+        few polls and then sleep for short intervals, so an idle ingestor stays cheap.
+ * @note   The optimizer must not be used by other threads while the ingestor runs.
+        Read its solution after flush() (while no producer pushes) or after close(),
+        or enable snapshots (SubmodularOptimizer::enable_snapshots) and read
+        get_snapshot() at any time.
+
+        Errors are sticky: once the optimizer threw, its state is undefined and the
+        ingestor has failed. The consumer drops all remaining and later elements, and
+        every following try_push(), push(), flush() and close() re-throws the first
+        exception.
+ */
+class ConcurrentIngestor {
+private:
+    struct Element {
+        vector<data_t> x;
+        optional<idx_t> id;
+        bool valid = true;
+    };
+
+    function<void(vector<data_t> const&, optional<idx_t>)> consume;
+    // Called by flush(), e.g. to pass the partial batch of a FanOut to its optimizers
+    function<void()> finish;
+    // Passes a new smallest sampling probability to the optimizer(s), see enable_load_shedding()
+    function<void(double)> sampled;
+
+    MPSCRingBuffer<Element> buffer;
+    size_t batch_size;
+    size_t high_watermark;
+
+    atomic<uint64_t> pushed;
+    // Elements taken from the buffer, including shed ones and ones dropped after an error.
+    // Only for statistics, flush() waits for the position of the consumer in the buffer
+    atomic<uint64_t> drained;
+    // Elements passed to the optimizer
+    atomic<uint64_t> processed;
+    atomic<uint64_t> rejected;
+    atomic<uint64_t> flush_requests;
+    atomic<uint64_t> flushes_done;
+    atomic<bool> stop;
+    // Number of producers inside try_push. The consumer only exits after stop was set and
+    // no producer is inside, so a push which passed the stop check is never lost
+    atomic<uint32_t> producers;
+
+    // Load shedding, see enable_load_shedding(). The parameters are written before
+    // `shedding' is set and only read by the consumer afterwards
+    atomic<bool> shedding;
+    double max_delay = 0;
+    double min_probability = 1;
+    mt19937_64 generator;
+    atomic<double> probability;
+    atomic<double> lowest_probability;
+    atomic<double> cost;
+    atomic<uint64_t> shed;
+
+    // The first exception of the optimizer, which is kept, see the class description
+    mutex error_lock;
+    exception_ptr error;
+    atomic<bool> failed;
+    thread consumer;
+
+    void set_error(exception_ptr e) {
+        lock_guard<mutex> guard(error_lock);
+        if (!error) error = e;
+        failed.store(true, memory_order_release);
+    }
+
+    void rethrow_error() {
+        if (!failed.load(memory_order_acquire)) return;
+        lock_guard<mutex> guard(error_lock);
+        rethrow_exception(error);
+    }
+
+    // Adapts the sampling probability after a batch in which `kept' elements took `seconds'
+    void adapt(size_t kept, double seconds) {
+        double c = cost.load(memory_order_relaxed);
+        if (kept > 0) {
+            double sample = seconds / kept;
+            c = c == 0 ? sample : (1 - COST_SMOOTHING) * c + COST_SMOOTHING * sample;
+            cost.store(c, memory_order_relaxed);
+        }
+
+        // The time it takes to process the backlog without sampling
+        double delay = buffer.size() * c;
+        double target = delay > max_delay ? max(min_probability, max_delay / delay) : 1.0;
+        double p = probability.load(memory_order_relaxed);
+        // React to bursts at once, but recover gradually so that p does not oscillate
+        p = target < p ? target : min(target, 2 * p);
+        probability.store(p, memory_order_relaxed);
+        if (p < lowest_probability.load(memory_order_relaxed)) {
+            lowest_probability.store(p, memory_order_relaxed);
+        }
+    }
+
+    void drain() {
+        // The smallest sampling probability the optimizer knows about
+        double folded = 1.0;
+        uniform_real_distribution<double> coin(0.0, 1.0);
+        unsigned int idle = 0;
+        while (true) {
+            bool sample = shedding.load(memory_order_acquire);
+            double p = probability.load(memory_order_relaxed);
+            auto begin = sample ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+
+            size_t n = 0;
+            size_t kept = 0;
+            Element* e;
+            while (n < batch_size && (e = buffer.consumer_slot()) != nullptr) {
+                // After an error the remaining elements are dropped, so that producers do not wait forever
+                if (!failed.load(memory_order_relaxed) && e->valid) {
+                    if (sample && p < 1 && coin(generator) >= p) {
+                        shed.fetch_add(1, memory_order_relaxed);
+                    }
+                    else {
+                        try {
+                            consume(e->x, e->id);
+                            ++kept;
+                        }
+                        catch (...) {
+                            set_error(current_exception());
+                        }
+                    }
+                }
+                buffer.release();
+                ++n;
+            }
+            if (n > 0) {
+                processed.fetch_add(kept, memory_order_relaxed);
+                drained.fetch_add(n, memory_order_release);
+                if (sample) {
+                    adapt(kept, chrono::duration<double>(chrono::steady_clock::now() - begin).count());
+                    double lowest = lowest_probability.load(memory_order_relaxed);
+                    if (!failed.load(memory_order_relaxed) && lowest < folded) {
+                        try {
+                            sampled(lowest);
+                            folded = lowest;
+                        }
+                        catch (...) {
+                            set_error(current_exception());
+                        }
+                    }
+                }
+            }
+            else if (sample) {
+                // An empty buffer means there is no overload
+                probability.store(1.0, memory_order_relaxed);
+            }
+
+            uint64_t requested = flush_requests.load(memory_order_acquire);
+            if (requested != flushes_done.load(memory_order_relaxed)) {
+                if (!failed.load(memory_order_relaxed) && finish) {
+                    try {
+                        finish();
+                    }
+                    catch (...) {
+                        set_error(current_exception());
+                    }
+                }
+                flushes_done.store(requested, memory_order_release);
+                idle = 0;
+                continue;
+            }
+            if (n > 0) {
+                idle = 0;
+                continue;
+            }
+
+            if (stop.load(memory_order_seq_cst) && producers.load(memory_order_seq_cst) == 0 && buffer.empty()) {
+                return;
+            }
+            back_off(idle);
+        }
+    }
+
+    // Yields for the first empty polls and sleeps afterwards, so that an idle ingestor does not occupy a core
+    static void back_off(unsigned int& polls) {
+        if (polls < SPIN_POLLS) {
+            ++polls;
+            this_thread::yield();
+        }
+        else {
+            this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+
+    static size_t watermark_elements(double high_watermark, size_t capacity) {
+        if (!(high_watermark > 0 && high_watermark <= 1)) {
+            throw runtime_error("ConcurrentIngestor: The high watermark must be in (0, 1].");
+        }
+        return max<size_t>(1, static_cast<size_t>(high_watermark * capacity));
+    }
+
+    // Waits for flush() without re-throwing errors
+    void wait_flushed() {
+        // Every push which returned before this call claimed a slot before the current tail.
+        // Comparing counters instead would be satisfied by a batch which only drained a
+        // slot claimed earlier by a stalled producer
+        size_t target = buffer.claimed();
+        unsigned int polls = 0;
+        while (buffer.released() < target) {
+            back_off(polls);
+        }
+        uint64_t request = flush_requests.fetch_add(1, memory_order_acq_rel) + 1;
+        polls = 0;
+        while (flushes_done.load(memory_order_acquire) < request) {
+            back_off(polls);
+        }
+    }
+
+    void start() {
+        if (batch_size == 0) {
+            throw runtime_error("ConcurrentIngestor: The batch size must be positive.");
+        }
+        consumer = thread(&ConcurrentIngestor::drain, this);
+    }
+
+public:
+    /**
+     * @brief  Starts a consumer thread which feeds `optimizer'.
+     * @param  optimizer: A streaming optimizer, which must outlive the ingestor.
+     * @param  capacity: The maximum number of buffered elements, rounded up to a power of two.
+     * @param  batch_size: The maximum number of elements the consumer passes to the
+            optimizer before it updates the progress counters and checks for flushes.
+     * @param  high_watermark: The fill level in (0, 1] above which is_congested() is true.
+     */
+    ConcurrentIngestor(SubmodularOptimizer& optimizer, size_t capacity = 4096, size_t batch_size = 256, double high_watermark = 0.75)
+        : consume([&optimizer](vector<data_t> const& x, optional<idx_t> id) { optimizer.next(x, id); }),
+          sampled([&optimizer](double p) { optimizer.set_sampling_probability(p); }),
+          buffer(capacity), batch_size(batch_size),
+          high_watermark(watermark_elements(high_watermark, buffer.capacity())),
+          pushed(0), drained(0), processed(0), rejected(0), flush_requests(0), flushes_done(0), stop(false), producers(0), failed(false),
+          shedding(false), probability(1.0), lowest_probability(1.0), cost(0), shed(0) {
+        start();
+    }
+
+    /**
+     * @brief  Starts a consumer thread which feeds `fan_out', which in turn runs its
+            optimizers on its own worker threads. flush() also flushes the fan-out.
+     */
+    ConcurrentIngestor(FanOut& fan_out, size_t capacity = 4096, size_t batch_size = 256, double high_watermark = 0.75)
+        : consume([&fan_out](vector<data_t> const& x, optional<idx_t> id) { fan_out.next(x, id); }),
+          finish([&fan_out]() { fan_out.flush(); }),
+          sampled([&fan_out](double p) { fan_out.set_sampling_probability(p); }),
+          buffer(capacity), batch_size(batch_size),
+          high_watermark(watermark_elements(high_watermark, buffer.capacity())),
+          pushed(0), drained(0), processed(0), rejected(0), flush_requests(0), flushes_done(0), stop(false), producers(0), failed(false),
+          shedding(false), probability(1.0), lowest_probability(1.0), cost(0), shed(0) {
+        start();
+    }
+
+    ConcurrentIngestor(ConcurrentIngestor const&) = delete;
+    ConcurrentIngestor& operator=(ConcurrentIngestor const&) = delete;
+
+    // Weight of the newest batch in the moving average of the cost per element
+    static constexpr double COST_SMOOTHING = 0.1;
+
+    // Number of empty polls the consumer and waiting producers spin before they sleep
+    static constexpr unsigned int SPIN_POLLS = 64;
+
+    // Sleep between polls once the spinning gave up, bounds the added latency after an idle phase
+    static constexpr chrono::microseconds IDLE_SLEEP{ 50 };
+
+    /**
+     * @brief  Lets the consumer subsample the stream when it falls behind, instead of
+            pushing back on the producers. After every batch, the consumer compares
+            the time it would take to process the buffered elements (buffered
+            elements times the moving average of the cost per element) with
+            `max_delay'. If the backlog is too large, every following element is only
+            passed to the optimizer with probability p = max_delay / backlog time, but
+            at least `min_probability'. p is raised again (at most doubled per batch)
+            once the backlog shrinks, and reset to 1 when the buffer runs empty.
+
+            Approximation: if every element is kept with probability at least p_min
+            (see get_min_sampling_probability), then for monotone submodular f with
+            f(empty set) = 0 the optimal solution O of the whole stream satisfies
+            E[f(O restricted to the sample)] >= p_min * f(O), because every element of O
+            contributes its marginal gain with probability >= p_min. OPT of the sample
+            can thus be about p_min * OPT, which is below the smallest OPT guess m of
+            SieveStreaming(++). Whenever p_min decreases, the consumer therefore passes
+            it to the optimizer (SubmodularOptimizer::set_sampling_probability), whose
+            sieves then cover the guesses down to p_min * m. With this, an optimizer
+            with factor c on the sample (e.g. 1/2 - epsilon for SieveStreaming(++))
+            is c * p_min-approximate in expectation, see get_approximation_factor.
+     * @note   Latency is bounded by about max_delay as long as p >= min_probability
+            suffices, beyond that the buffer fills and producers are pushed back.
+            The sample is random, so results are not reproducible across runs
+            unless the load is.
+     * @param  max_delay: The maximal expected time in seconds an element waits in the buffer.
+     * @param  min_probability: The smallest sampling probability in (0, 1].
+     * @param  seed: The seed of the random generator which decides about sampling.
+     * @retval None
+     */
+    void enable_load_shedding(double max_delay, double min_probability = 0.01, unsigned long seed = 0) {
+        if (max_delay <= 0) {
+            throw runtime_error("ConcurrentIngestor: The maximal delay must be positive.");
+        }
+        if (min_probability <= 0 || min_probability > 1) {
+            throw runtime_error("ConcurrentIngestor: The minimal sampling probability must be in (0, 1].");
+        }
+        if (shedding.load(memory_order_acquire)) {
+            throw runtime_error("ConcurrentIngestor: Load shedding is already enabled.");
+        }
+        this->max_delay = max_delay;
+        this->min_probability = min_probability;
+        generator.seed(seed);
+        shedding.store(true, memory_order_release);
+    }
+
+    /**
+     * @brief  Producer: buffers x without waiting for the optimizer. Thread-safe.
+     * @param  x: A constant reference to the next object on the stream, it is copied.
+     * @param  id: The id of x.
+     * @retval false if the buffer is full and x was not taken (backpressure).
+     * @note   A push which runs concurrently with close() either throws or its element is
+            passed to the optimizer before close() returns.
+     */
+    bool try_push(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+        struct Inside {
+            atomic<uint32_t>& producers;
+            ~Inside() { producers.fetch_sub(1, memory_order_seq_cst); }
+        };
+        // Announce the producer before checking stop, see drain()
+        producers.fetch_add(1, memory_order_seq_cst);
+        Inside inside{ producers };
+        if (stop.load(memory_order_seq_cst)) {
+            throw runtime_error("ConcurrentIngestor: The ingestor was closed.");
+        }
+        rethrow_error();
+        bool allocation_failed = false;
+        bool ok = buffer.try_push([&](Element& e) {
+            try {
+                e.x.assign(x.begin(), x.end());
+                e.id = id;
+                e.valid = true;
+            }
+            catch (...) {
+                e.valid = false;
+                allocation_failed = true;
+            }
+        });
+        if (!ok) {
+            rejected.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        // The invalid slot is published (and skipped by the consumer) before reporting the error
+        pushed.fetch_add(1, memory_order_release);
+        if (allocation_failed) {
+            throw bad_alloc();
+        }
+        return true;
+    }
+
+    /**
+     * @brief  Producer: like try_push, but retries until there is space in the buffer.
+     * @note   Spins for SPIN_POLLS retries and then sleeps IDLE_SLEEP between retries.
+     */
+    void push(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+        unsigned int polls = 0;
+        while (!try_push(x, id)) {
+            back_off(polls);
+        }
+    }
+
+    /**
+     * @brief  Waits until every element which was pushed before the call (by any thread)
+            was passed to the optimizer, and flushes a FanOut. Re-throws the first
+            exception thrown by the optimizer, also if it was re-thrown before.
+     */
+    void flush() {
+        wait_flushed();
+        rethrow_error();
+    }
+
+    /**
+     * @brief  Processes all buffered elements and stops the consumer thread. Afterwards
+            try_push() throws. Re-throws the first exception thrown by the optimizer.
+     */
+    void close() {
+        if (!consumer.joinable()) {
+            rethrow_error();
+            return;
+        }
+        wait_flushed();
+        stop.store(true, memory_order_seq_cst);
+        consumer.join();
+        rethrow_error();
+    }
+
+    // Number of currently buffered elements (approximate while producers push)
+    inline size_t buffered() const { return buffer.size(); }
+
+    inline size_t capacity() const { return buffer.capacity(); }
+
+    // True if the buffer is filled above the high watermark, i.e. producers should slow down
+    inline bool is_congested() const { return buffer.size() >= high_watermark; }
+
+    // Number of elements accepted by try_push / push
+    inline uint64_t get_num_pushed() const { return pushed.load(memory_order_relaxed); }
+
+    // Number of elements taken from the buffer, i.e. processed, shed or dropped after an error
+    inline uint64_t get_num_drained() const { return drained.load(memory_order_relaxed); }
+
+    // Number of elements passed to the optimizer
+    inline uint64_t get_num_processed() const { return processed.load(memory_order_relaxed); }
+
+    // Number of failed try_push calls because the buffer was full
+    inline uint64_t get_num_rejected() const { return rejected.load(memory_order_relaxed); }
+
+    // Number of elements which were not passed to the optimizer due to load shedding
+    inline uint64_t get_num_shed() const { return shed.load(memory_order_relaxed); }
+
+    // The current sampling probability, 1 without load shedding
+    inline double get_sampling_probability() const { return probability.load(memory_order_relaxed); }
+
+    // The smallest sampling probability so far, which determines the approximation factor
+    inline double get_min_sampling_probability() const { return lowest_probability.load(memory_order_relaxed); }
+
+    // The moving average of the time in seconds the optimizer takes per element, 0 without load shedding
+    inline double get_element_cost() const { return cost.load(memory_order_relaxed); }
+
+    /**
+     * @brief  The expected approximation factor with respect to the whole stream, see
+            enable_load_shedding.
+     * @param  factor: The factor of the optimizer without sampling, e.g. 1/2 - epsilon.
+     * @retval factor * get_min_sampling_probability()
+     */
+    inline double get_approximation_factor(double factor) const {
+        return factor * get_min_sampling_probability();
+    }
+
+    ~ConcurrentIngestor() {
+        stop.store(true, memory_order_seq_cst);
+        if (consumer.joinable()) consumer.join();
+    }
+};
+
+#endif // CONCURRENT_INGESTOR_H
@@ -0,0 +1,76 @@
+#ifndef DATA_SOURCE_H
+#define DATA_SOURCE_H
+
+#include <vector>
+#include <functional>
+
+#include "DataTypeHandling.h"
+#include "Dataset.h"
+
+using namespace std;
+
+/**
+ * @brief  Interface for (possibly unbounded) data streams. A DataSource hands out one
+        element at a time, so a streaming optimizer only needs memory for the
+        elements it keeps and not for the whole stream. See
+        SubmodularOptimizer::fit(DataSource&).
+ */
+class DataSource {
+public:
+    /**
+     * @brief  Reads the next element of the stream.
+     * @param  x: Is overwritten with the next element. Implementations should re-use
+            the capacity of x so that reading does not allocate in steady state.
+     * @param  id: Is set to the id of the next element.
+     * @retval false if the stream is exhausted, true otherwise.
+     */
+    virtual bool next(vector<data_t>& x, idx_t& id) = 0;
+
+    virtual ~DataSource() {}
+};
+
+/**
+ * @brief  A DataSource which calls a generator function for every element, e.g. to
+        produce synthetic data on the fly. Ids are assigned consecutively.
+ */
+class GeneratorDataSource : public DataSource {
+protected:
+    // Fills its argument with the next element, returns false once exhausted
+    function<bool(vector<data_t>&)> generator;
+    idx_t cnt = 0;
+
+public:
+    GeneratorDataSource(function<bool(vector<data_t>&)> generator) : generator(generator) {}
+
+    bool next(vector<data_t>& x, idx_t& id) override {
+        if (!generator(x)) {
+            return false;
+        }
+        id = cnt++;
+        return true;
+    }
+};
+
+/**
+ * @brief  A DataSource which streams the rows of a DatasetView, e.g. a memory-mapped
+        binary data set. The id of a row is its index.
+ */
+class DatasetViewDataSource : public DataSource {
+protected:
+    DatasetView X;
+    size_t pos = 0;
+
+public:
+    DatasetViewDataSource(DatasetView const& X) : X(X) {}
+
+    bool next(vector<data_t>& x, idx_t& id) override {
+        if (pos >= X.size()) {
+            return false;
+        }
+        x.assign(X.row(pos), X.row(pos) + X.dimension());
+        id = static_cast<idx_t>(pos++);
+        return true;
+    }
+};
+
+#endif // DATA_SOURCE_H
@@ -3,7 +3,21 @@
 
 #include <vector>
 
-typedef double data_t;//
-typedef long idx_t;//
+/*
+* 特征数据类型。默认为double，编译时定义SUBMODULAR_SINGLE_PRECISION则使用float，
+* 数据集与每个筛子中存储的解所占内存减半，核函数计算的SIMD宽度加倍。
+*/
+#ifdef SUBMODULAR_SINGLE_PRECISION
+typedef float data_t;//数据类型
+#else
+typedef double data_t;//数据类型
+#endif
+
+/*
+* 累加类型。核矩阵、cholesky分解以及对数行列式的累加始终使用double，
+* 避免单精度下pivot误差累积导致函数值漂移。
+*/
+typedef double accum_t;
+typedef long idx_t;//索引类型
 
 #endif
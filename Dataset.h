@@ -0,0 +1,93 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <vector>
+#include <cstddef>
+
+#include "DataTypeHandling.h"
+
+using namespace std;
+
+/**
+ * @brief  A non-owning, read-only view of N rows with D features each. Row i starts
+        at data + i * stride. Views are cheap to copy and are used to hand contiguous
+        (e.g. memory-mapped) data sets to the optimizers without materializing one
+        vector per row, see SubmodularOptimizer::fit(DatasetView const&, ...).
+ */
+struct DatasetView {
+    data_t const* data;
+    size_t N;
+    size_t D;
+    size_t stride;
+
+    DatasetView() : data(nullptr), N(0), D(0), stride(0) {}
+
+    DatasetView(data_t const* data, size_t N, size_t D)
+        : data(data), N(N), D(D), stride(D) {}
+
+    DatasetView(data_t const* data, size_t N, size_t D, size_t stride)
+        : data(data), N(N), D(D), stride(stride) {}
+
+    inline size_t size() const { return N; }
+    inline size_t dimension() const { return D; }
+    inline data_t const* row(size_t i) const { return data + i * stride; }
+};
+
+/**
+ * @brief  A dense data set stored as one contiguous, row-major N x D buffer. Loaders
+        write directly into this buffer, so loading does not allocate one vector per
+        row. Use `to_rows' to obtain the vector-of-vectors layout expected by
+        SubmodularOptimizer::fit.
+ */
+class Dataset {
+private:
+    size_t N;
+    size_t D;
+    vector<data_t> data;
+
+public:
+    Dataset() : N(0), D(0) {}
+
+    /**
+     * @brief  Creates a zero-initialized data set with N rows and D columns.
+     */
+    Dataset(size_t N, size_t D) : N(N), D(D), data(N * D, 0) {}
+
+    // Number of rows
+    inline size_t size() const { return N; }
+
+    // Number of columns
+    inline size_t dimension() const { return D; }
+
+    inline data_t* row(size_t i) { return &data[i * D]; }
+    inline data_t const* row(size_t i) const { return &data[i * D]; }
+
+    inline data_t& operator()(size_t i, size_t j) { return data[i * D + j]; }
+    inline data_t operator()(size_t i, size_t j) const { return data[i * D + j]; }
+
+    /**
+     * @brief  Keeps the first n rows and drops the rest.
+     */
+    void truncate(size_t n) {
+        if (n < N) {
+            N = n;
+            data.resize(N * D);
+        }
+    }
+
+    inline DatasetView view() const { return DatasetView(data.data(), N, D); }
+
+    /**
+     * @brief  Copies the data set into one vector per row.
+     */
+    vector<vector<data_t>> to_rows() const {
+        vector<vector<data_t>> X;
+        X.reserve(N);
+        for (size_t i = 0; i < N; ++i) {
+            X.emplace_back(row(i), row(i) + D);
+        }
+        return X;
+    }
+};
+
+#endif // DATASET_H
@@ -0,0 +1,448 @@
+#ifndef DATASET_LOADER_H
+#define DATASET_LOADER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "DataTypeHandling.h"
+#include "Dataset.h"
+
+using namespace std;
+
+/**
+ * @brief  Read-only memory mapping of an entire file. The mapping is released in the
+        destructor. Empty files are valid and result in size() == 0.
+ */
+class MemoryMappedFile {
+private:
+    char const* ptr = nullptr;
+    size_t len = 0;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+
+public:
+    explicit MemoryMappedFile(string const& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw runtime_error("MemoryMappedFile: Could not open " + path);
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        len = static_cast<size_t>(file_size.QuadPart);
+        if (len > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping == NULL) {
+                CloseHandle(file);
+                throw runtime_error("MemoryMappedFile: Could not map " + path);
+            }
+            ptr = static_cast<char const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("MemoryMappedFile: Could not open " + path);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        len = static_cast<size_t>(st.st_size);
+        if (len > 0) {
+            void* p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("MemoryMappedFile: Could not map " + path);
+            }
+            madvise(p, len, MADV_SEQUENTIAL);
+            ptr = static_cast<char const*>(p);
+        }
+#endif
+    }
+
+    MemoryMappedFile(MemoryMappedFile const&) = delete;
+    MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+
+    inline char const* data() const { return ptr; }
+    inline size_t size() const { return len; }
+
+    ~MemoryMappedFile() {
+#ifdef _WIN32
+        if (ptr != nullptr) UnmapViewOfFile(ptr);
+        if (mapping != NULL) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (ptr != nullptr) munmap(const_cast<char*>(ptr), len);
+        if (fd >= 0) close(fd);
+#endif
+    }
+};
+
+/**
+ * @brief  Options for load_arff / load_csv.
+ */
+struct DatasetLoaderOptions {
+    // Names of the columns to load, in this order. If empty, every numeric attribute
+    // (ARFF) or every column (CSV) is loaded except those listed in `exclude'.
+    vector<string> columns;
+
+    // Names of the columns to skip if `columns' is empty.
+    vector<string> exclude;
+
+    // Field delimiter.
+    char delimiter = ',';
+
+    // CSV only: whether the first line holds the column names. Without a header the
+    // columns are named "0", "1", ...
+    bool has_header = true;
+
+    // Number of parser threads. 0 uses std::thread::hardware_concurrency().
+    unsigned int num_threads = 0;
+};
+
+/**
+ * @brief  A column of a delimited file as declared by its header.
+ */
+struct DatasetColumn {
+    string name;
+    bool numeric;
+};
+
+/**
+ * @brief  Helpers shared by load_arff and load_csv.
+ */
+class DelimitedParser {
+public:
+
+    static bool iequals(string const& a, string const& b) {
+        return a.size() == b.size() && equal(a.begin(), a.end(), b.begin(),
+            [](char x, char y) { return tolower(x) == tolower(y); });
+    }
+
+    static char const* skip_spaces(char const* p, char const* end) {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        return p;
+    }
+
+    // Returns the end of the line starting at p, without the trailing '\r'
+    static char const* line_end(char const* p, char const* end, char const*& next) {
+        char const* nl = static_cast<char const*>(memchr(p, '\n', end - p));
+        next = (nl == nullptr) ? end : nl + 1;
+        char const* e = (nl == nullptr) ? end : nl;
+        if (e > p && e[-1] == '\r') --e;
+        return e;
+    }
+
+    // Empty lines, ARFF comments and ARFF meta information are not data
+    static bool is_data_line(char const* p, char const* e) {
+        p = skip_spaces(p, e);
+        return p < e && *p != '%' && *p != '@';
+    }
+
+    // Splits [p, e) at `delimiter' and strips surrounding spaces and quotes.
+    static vector<string> split_fields(char const* p, char const* e, char delimiter) {
+        vector<string> fields;
+        while (p <= e) {
+            char const* f = static_cast<char const*>(memchr(p, delimiter, e - p));
+            if (f == nullptr) f = e;
+            char const* b = skip_spaces(p, f);
+            char const* fe = f;
+            while (fe > b && (fe[-1] == ' ' || fe[-1] == '\t')) --fe;
+            if (fe - b >= 2 && (*b == '\'' || *b == '"') && fe[-1] == *b) {
+                ++b; --fe;
+            }
+            fields.emplace_back(b, fe);
+            p = f + 1;
+        }
+        return fields;
+    }
+
+    // Parses a single field. Unparsable fields (e.g. ARFF's '?' for missing values)
+    // become 0 like atof would return.
+    static data_t parse_field(char const* b, char const* e) {
+        b = skip_spaces(b, e);
+        if (b < e && (*b == '\'' || *b == '"')) ++b;
+        if (b < e && *b == '+') ++b;
+        data_t value = 0;
+        if (from_chars(b, e, value).ec != errc()) {
+            value = 0;
+        }
+        return value;
+    }
+
+    /**
+     * @brief  Parses the data line [p, e) into row.
+     * @param  col_map: For each field index the target column or -1 to skip it.
+     * @param  D: The number of selected columns.
+     * @retval false if the line has too few fields.
+     */
+    static bool parse_row(char const* p, char const* e, vector<int> const& col_map,
+        size_t D, char delimiter, data_t* row) {
+        size_t field = 0, found = 0;
+        char const* f = p;
+        while (field < col_map.size() && f <= e) {
+            char const* fe = static_cast<char const*>(memchr(f, delimiter, e - f));
+            if (fe == nullptr) fe = e;
+            int c = col_map[field];
+            if (c >= 0) {
+                row[c] = parse_field(f, fe);
+                ++found;
+            }
+            f = fe + 1;
+            ++field;
+        }
+        return found == D;
+    }
+
+    /**
+     * @brief  Parses the data section [begin, end) into a contiguous N x D buffer.
+            The section is cut into line-aligned chunks, one per thread. A first
+            parallel pass counts the data lines of each chunk so that every thread
+            knows the first row it owns, a second parallel pass parses every chunk
+            directly into its rows. Lines with too few fields are dropped.
+     * @param  col_map: For each field index the target column or -1 to skip it.
+     * @param  D: The number of selected columns.
+     */
+    static Dataset parse_delimited(char const* begin, char const* end, vector<int> const& col_map,
+        size_t D, char delimiter, unsigned int num_threads, size_t& ignored) {
+        if (num_threads == 0) {
+            num_threads = max(1u, thread::hardware_concurrency());
+        }
+        size_t bytes = end - begin;
+        num_threads = static_cast<unsigned int>(min<size_t>(num_threads, max<size_t>(1, bytes / (1 << 16))));
+
+        vector<char const*> starts(num_threads + 1, end);
+        starts[0] = begin;
+        for (unsigned int t = 1; t < num_threads; ++t) {
+            char const* p = begin + bytes / num_threads * t;
+            p = max(p, starts[t - 1]);
+            char const* nl = static_cast<char const*>(memchr(p, '\n', end - p));
+            starts[t] = (nl == nullptr) ? end : nl + 1;
+        }
+
+        auto parallel = [num_threads](auto&& work) {
+            vector<thread> workers;
+            for (unsigned int t = 1; t < num_threads; ++t) {
+                workers.emplace_back(work, t);
+            }
+            work(0);
+            for (auto& w : workers) w.join();
+        };
+
+        // Pass 1: count rows per chunk
+        vector<size_t> offsets(num_threads + 1, 0);
+        parallel([&](unsigned int t) {
+            size_t cnt = 0;
+            char const* next;
+            for (char const* p = starts[t]; p < starts[t + 1]; p = next) {
+                char const* e = line_end(p, starts[t + 1], next);
+                if (is_data_line(p, e)) ++cnt;
+            }
+            offsets[t + 1] = cnt;
+        });
+        for (unsigned int t = 0; t < num_threads; ++t) {
+            offsets[t + 1] += offsets[t];
+        }
+
+        // Pass 2: parse every chunk into its own rows
+        Dataset X(offsets[num_threads], D);
+        vector<char> valid(X.size(), 1);
+        parallel([&](unsigned int t) {
+            size_t i = offsets[t];
+            char const* next;
+            for (char const* p = starts[t]; p < starts[t + 1]; p = next) {
+                char const* e = line_end(p, starts[t + 1], next);
+                if (!is_data_line(p, e)) continue;
+
+                valid[i] = parse_row(p, e, col_map, D, delimiter, X.row(i));
+                ++i;
+            }
+        });
+
+        // Compact rows with a size mismatch away
+        size_t n = 0;
+        for (size_t i = 0; i < X.size(); ++i) {
+            if (valid[i]) {
+                if (n != i) copy(X.row(i), X.row(i) + D, X.row(n));
+                ++n;
+            }
+        }
+        ignored = X.size() - n;
+        X.truncate(n);
+        return X;
+    }
+
+    // Maps every field of the file to its target column according to `options'
+    static vector<int> select_columns(vector<DatasetColumn> const& header, DatasetLoaderOptions const& options, size_t& D) {
+        vector<int> col_map(header.size(), -1);
+        D = 0;
+        if (options.columns.empty()) {
+            for (size_t i = 0; i < header.size(); ++i) {
+                bool excluded = any_of(options.exclude.begin(), options.exclude.end(),
+                    [&](string const& name) { return iequals(name, header[i].name); });
+                if (header[i].numeric && !excluded) {
+                    col_map[i] = static_cast<int>(D++);
+                }
+            }
+        }
+        else {
+            for (auto const& name : options.columns) {
+                auto it = find_if(header.begin(), header.end(),
+                    [&](DatasetColumn const& c) { return iequals(name, c.name); });
+                if (it == header.end()) {
+                    throw runtime_error("select_columns: Unknown column " + name);
+                }
+                col_map[distance(header.begin(), it)] = static_cast<int>(D++);
+            }
+        }
+        // Fields after the last selected one do not need to be scanned at all
+        while (!col_map.empty() && col_map.back() < 0) col_map.pop_back();
+        return col_map;
+    }
+
+    static void report_ignored(size_t ignored) {
+        if (ignored > 0) {
+            cout << "Size mismatch detected. Ignored " << ignored << " line(s)." << endl;
+        }
+    }
+};
+
+/**
+ * @brief  Reads the `@attribute' declarations of an ARFF header.
+ * @param  begin / end: The file content.
+ * @param  data_begin: Set to the first byte after the `@data' line.
+ * @retval The declared columns in file order.
+ */
+inline vector<DatasetColumn> parse_arff_header(char const* begin, char const* end, char const*& data_begin) {
+    vector<DatasetColumn> header;
+    char const* next;
+    for (char const* p = begin; p < end; p = next) {
+        char const* e = DelimitedParser::line_end(p, end, next);
+        char const* b = DelimitedParser::skip_spaces(p, e);
+        if (b == e || *b != '@') continue;
+
+        char const* kw_end = b;
+        while (kw_end < e && !isspace(static_cast<unsigned char>(*kw_end))) ++kw_end;
+        string keyword(b, kw_end);
+
+        if (DelimitedParser::iequals(keyword, "@data")) {
+            data_begin = next;
+            return header;
+        }
+        if (DelimitedParser::iequals(keyword, "@attribute")) {
+            char const* n = DelimitedParser::skip_spaces(kw_end, e);
+            char const* n_end;
+            if (n < e && (*n == '\'' || *n == '"')) {
+                n_end = static_cast<char const*>(memchr(n + 1, *n, e - n - 1));
+                if (n_end == nullptr) n_end = e;
+                header.push_back({ string(n + 1, n_end), false });
+                n_end = min(n_end + 1, e);
+            }
+            else {
+                n_end = n;
+                while (n_end < e && !isspace(static_cast<unsigned char>(*n_end))) ++n_end;
+                header.push_back({ string(n, n_end), false });
+            }
+            char const* t = DelimitedParser::skip_spaces(n_end, e);
+            char const* t_end = t;
+            while (t_end < e && !isspace(static_cast<unsigned char>(*t_end))) ++t_end;
+            string type(t, t_end);
+            header.back().numeric = DelimitedParser::iequals(type, "numeric") || DelimitedParser::iequals(type, "real")
+                || DelimitedParser::iequals(type, "integer");
+        }
+    }
+    throw runtime_error("parse_arff_header: No @data section found.");
+}
+
+/**
+ * @brief  Loads the numeric columns of an ARFF file. The file is memory-mapped and
+        parsed with std::from_chars by several threads over line-aligned chunks,
+        writing straight into one contiguous N x D buffer.
+ * @param  path: Path to the ARFF file.
+ * @param  options: Column selection and threading, see DatasetLoaderOptions.
+ * @retval The loaded data set.
+ */
+inline Dataset load_arff(string const& path, DatasetLoaderOptions const& options = DatasetLoaderOptions()) {
+    MemoryMappedFile file(path);
+    char const* begin = file.data();
+    char const* end = begin + file.size();
+
+    char const* data_begin = end;
+    vector<DatasetColumn> header = parse_arff_header(begin, end, data_begin);
+
+    size_t D;
+    vector<int> col_map = DelimitedParser::select_columns(header, options, D);
+
+    size_t ignored;
+    Dataset X = DelimitedParser::parse_delimited(data_begin, end, col_map, D, options.delimiter, options.num_threads, ignored);
+    DelimitedParser::report_ignored(ignored);
+    return X;
+}
+
+/**
+ * @brief  Loads a CSV file, see load_arff. Every column is considered to be numeric.
+ * @param  path: Path to the CSV file.
+ * @param  options: Column selection, header and threading, see DatasetLoaderOptions.
+ * @retval The loaded data set.
+ */
+inline Dataset load_csv(string const& path, DatasetLoaderOptions const& options = DatasetLoaderOptions()) {
+    MemoryMappedFile file(path);
+    char const* begin = file.data();
+    char const* end = begin + file.size();
+
+    // The first data line either holds the column names or determines the number of columns
+    char const* first_begin = end;
+    char const* first_end = end;
+    char const* data_begin = end;
+    char const* next;
+    for (char const* p = begin; p < end; p = next) {
+        char const* e = DelimitedParser::line_end(p, end, next);
+        if (DelimitedParser::is_data_line(p, e)) {
+            first_begin = p;
+            first_end = e;
+            data_begin = options.has_header ? next : p;
+            break;
+        }
+    }
+    if (first_begin == end) {
+        return Dataset();
+    }
+
+    vector<DatasetColumn> header;
+    vector<string> fields = DelimitedParser::split_fields(first_begin, first_end, options.delimiter);
+    for (size_t i = 0; i < fields.size(); ++i) {
+        header.push_back({ options.has_header ? fields[i] : to_string(i), true });
+    }
+    size_t D;
+    vector<int> col_map = DelimitedParser::select_columns(header, options, D);
+
+    size_t ignored;
+    Dataset X = DelimitedParser::parse_delimited(data_begin, end, col_map, D, options.delimiter, options.num_threads, ignored);
+    DelimitedParser::report_ignored(ignored);
+    return X;
+}
+
+#endif // DATASET_LOADER_H
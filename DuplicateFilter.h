@@ -0,0 +1,165 @@
+#ifndef DUPLICATE_FILTER_H
+#define DUPLICATE_FILTER_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_set>
+#include <algorithm>
+
+#include "DataTypeHandling.h"
+#include "RowHash.h"
+
+using namespace std;
+
+/**
+ * @brief  Which elements are considered duplicates by a DuplicateFilter.
+ *      - seen: x is dropped if an identical row was passed to the optimizer before,
+ *        i.e. every distinct row is only considered once. Note, that this also skips
+ *        the later passes of fit(X, iterations > 1).
+ *      - accepted: x is dropped if an identical row was accepted into a solution
+ *        before (by any sieve for SieveStreaming(++)). Rows which were only rejected
+ *        are considered again.
+ */
+enum class DuplicateMode { seen, accepted };
+
+inline string to_string(DuplicateMode mode) {
+    return mode == DuplicateMode::seen ? "seen" : "accepted";
+}
+
+/**
+ * @brief  A set of 64 bit row hashes (see hash_row) which detects exact duplicates
+        before the optimizers query the submodular function. Two different rows are
+        only confused if their hashes collide, which for the hash set has a
+        probability of about n^2 / 2^65 for n distinct rows.
+        Optionally, a bloom filter replaces the hash set: it uses a fixed number of
+        bits for the expected number of distinct rows, but drops a distinct row with
+        the given false positive rate.
+ */
+class DuplicateFilter {
+private:
+    DuplicateMode mode;
+
+    // Exact mode
+    unordered_set<uint64_t> hashes;
+
+    // Bloom filter mode
+    vector<uint64_t> bits;
+    uint64_t num_bits = 0;
+    unsigned int num_hashes = 0;
+
+    uint64_t last = 0;
+    size_t dropped = 0;
+
+    // A second, independent hash for double hashing in the bloom filter
+    static inline uint64_t rehash(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h | 1;
+    }
+
+public:
+    /**
+     * @brief  Creates a new filter.
+     * @param  mode: Which elements are dropped, see DuplicateMode.
+     * @param  false_positive_rate: 0 uses an exact hash set. A value in (0, 1) uses a
+            bloom filter with this false positive rate for `expected_elements'.
+     * @param  expected_elements: The expected number of distinct rows stored in the
+            bloom filter. Ignored for the hash set.
+     */
+    DuplicateFilter(DuplicateMode mode = DuplicateMode::seen, double false_positive_rate = 0, size_t expected_elements = 1 << 20)
+        : mode(mode) {
+        if (false_positive_rate < 0 || false_positive_rate >= 1) {
+            throw runtime_error("DuplicateFilter: The false positive rate must be in [0, 1).");
+        }
+        if (false_positive_rate > 0) {
+            double n = static_cast<double>(max<size_t>(expected_elements, 1));
+            double ln2 = log(2.0);
+            num_bits = max<uint64_t>(64, static_cast<uint64_t>(ceil(-n * log(false_positive_rate) / (ln2 * ln2))));
+            num_hashes = max(1u, static_cast<unsigned int>(round(num_bits / n * ln2)));
+            bits.assign((num_bits + 63) / 64, 0);
+        }
+    }
+
+    inline DuplicateMode get_mode() const { return mode; }
+
+    inline bool is_bloom_filter() const { return num_bits > 0; }
+
+    // Number of elements dropped so far
+    inline size_t get_num_dropped() const { return dropped; }
+
+    // Memory used by the stored hashes / bits in bytes (approximately for the hash set)
+    inline size_t get_memory_bytes() const {
+        return is_bloom_filter() ? bits.size() * sizeof(uint64_t) : hashes.bucket_count() * sizeof(void*) + hashes.size() * (sizeof(uint64_t) + 2 * sizeof(void*));
+    }
+
+    inline bool contains(uint64_t h) const {
+        if (!is_bloom_filter()) {
+            return hashes.count(h) > 0;
+        }
+        uint64_t h2 = rehash(h);
+        for (unsigned int i = 0; i < num_hashes; ++i) {
+            uint64_t bit = (h + i * h2) % num_bits;
+            if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64)))) return false;
+        }
+        return true;
+    }
+
+    inline void insert(uint64_t h) {
+        if (!is_bloom_filter()) {
+            hashes.insert(h);
+            return;
+        }
+        uint64_t h2 = rehash(h);
+        for (unsigned int i = 0; i < num_hashes; ++i) {
+            uint64_t bit = (h + i * h2) % num_bits;
+            bits[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    /**
+     * @brief  Checks whether the row with hash h is a duplicate. In DuplicateMode::seen
+            the row is remembered. The hash is kept for a following accept().
+     * @retval true if the row should be dropped.
+     */
+    bool check(uint64_t h) {
+        last = h;
+        if (contains(h)) {
+            ++dropped;
+            return true;
+        }
+        if (mode == DuplicateMode::seen) {
+            insert(h);
+        }
+        return false;
+    }
+
+    inline bool check(vector<data_t> const& x) {
+        return check(hash_row(x));
+    }
+
+    // Remembers the row with hash h as accepted (only relevant in DuplicateMode::accepted)
+    inline void accept(uint64_t h) {
+        if (mode == DuplicateMode::accepted) {
+            insert(h);
+        }
+    }
+
+    // Remembers the row of the last call of check() as accepted
+    inline void accept() {
+        accept(last);
+    }
+
+    void clear() {
+        hashes.clear();
+        fill(bits.begin(), bits.end(), 0);
+        dropped = 0;
+    }
+};
+
+#endif // DUPLICATE_FILTER_H
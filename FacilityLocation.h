@@ -0,0 +1,273 @@
+#ifndef FACILITY_LOCATION_H
+#define FACILITY_LOCATION_H
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "DataTypeHandling.h"
+#include "SubmodularFunction.h"
+#include "Kernel.h"
+#include "RBFKernel.h"
+#include "RowHash.h"
+
+using namespace std;
+
+/**
+ * @brief  The facility location function
+ *
+ *      f(S) = sum_{i in V} max_{s in S} sim(i, s)
+ *
+ *  over a fixed ground set V, where sim is a non-negative Kernel, e.g. RBFKernel. It is
+ *  monotone submodular and rewards solutions which contain a close representative for
+ *  every point of V. The function keeps for every i in V the similarity to its best
+ *  representative in the current solution, so that
+ *      - peek(x) = fval + sum_i max(0, sim(i, x) - best[i])
+ *      - update(x) raises best[i] to sim(i, x) where it is larger
+ *  are incremental. Replacing an element (pos < current solution size, e.g. Random)
+ *  re-computes best from the current solution.
+ *
+ *  There are two modes:
+ *      - dense: sim(i, x) is evaluated for every i, i.e. a query costs O(|V| * D). The
+ *        loop over V is parallelized with OpenMP if available and for RBFKernel the
+ *        distance computation is a vectorizable loop over raw rows.
+ *      - sparse: a k-nearest-neighbor similarity graph of V is computed once, so that
+ *        every candidate x only covers the (at most) k points which have x among their
+ *        k most similar points. A query then costs O(nnz) instead of O(|V| * D).
+ *        Candidates must be elements of V; they are found through their row hash.
+ *
+ *  The ground set and the similarity graph are shared between all clones, every clone
+ *  (e.g. every sieve of SieveStreaming) only allocates the |V| best similarities.
+ */
+class FacilityLocation : public SubmodularFunction {
+public:
+    // Below this number of ground set elements the gain is computed on one thread
+    static constexpr long PARALLEL_THRESHOLD = 4096;
+
+protected:
+    struct GroundSet {
+        vector<vector<data_t>> V;
+        shared_ptr<Kernel> kernel;
+
+        // RBFKernel is evaluated directly on the rows
+        bool rbf = false;
+        data_t sigma = 1.0;
+        data_t scale = 1.0;
+
+        // Sparse mode: for every element j the elements it covers and their similarity
+        bool sparse = false;
+        vector<vector<pair<idx_t, data_t>>> covers;
+        unordered_multimap<uint64_t, idx_t> index;
+
+        inline data_t similarity(size_t i, data_t const* x) const {
+            if (rbf) {
+                data_t const* v = V[i].data();
+                size_t D = V[i].size();
+                accum_t distance = 0;
+                #pragma omp simd reduction(+:distance)
+                for (size_t d = 0; d < D; ++d) {
+                    accum_t diff = static_cast<accum_t>(v[d]) - x[d];
+                    distance += diff * diff;
+                }
+                return scale * exp(-distance / sigma);
+            }
+            return (*kernel)(V[i], vector<data_t>(x, x + V[i].size()));
+        }
+
+        // The ground set element which equals x
+        idx_t find(vector<data_t> const& x) const {
+            auto range = index.equal_range(hash_row(x));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (V[it->second] == x) return it->second;
+            }
+            throw runtime_error("FacilityLocation: In sparse mode every element must be part of the ground set.");
+        }
+    };
+
+    shared_ptr<GroundSet const> ground;
+    vector<data_t> best;
+    accum_t fval;
+
+    FacilityLocation(shared_ptr<GroundSet const> ground) : ground(ground), best(ground->V.size(), 0), fval(0) {}
+
+    static shared_ptr<GroundSet> make_ground_set(vector<vector<data_t>> const& V, Kernel const& kernel) {
+        auto g = make_shared<GroundSet>();
+        g->V = V;
+        g->kernel = kernel.clone();
+        if (auto rbf = dynamic_cast<RBFKernel const*>(&kernel)) {
+            g->rbf = true;
+            g->sigma = rbf->get_sigma();
+            g->scale = rbf->get_scale();
+        }
+        return g;
+    }
+
+    static shared_ptr<GroundSet> make_sparse_ground_set(vector<vector<data_t>> const& V, Kernel const& kernel, size_t k) {
+        auto g = make_ground_set(V, kernel);
+        long N = static_cast<long>(V.size());
+        k = min(k, V.size());
+
+        // neighbors[i] = the k most similar elements of i
+        vector<vector<pair<idx_t, data_t>>> neighbors(N);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (long i = 0; i < N; ++i) {
+            vector<pair<idx_t, data_t>> sims(N);
+            for (long j = 0; j < N; ++j) {
+                sims[j] = { j, g->similarity(i, V[j].data()) };
+            }
+            partial_sort(sims.begin(), sims.begin() + k, sims.end(),
+                [](auto const& a, auto const& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); }
+            );
+            sims.resize(k);
+            neighbors[i] = move(sims);
+        }
+
+        g->sparse = true;
+        g->covers.resize(N);
+        for (long i = 0; i < N; ++i) {
+            for (auto const& n : neighbors[i]) {
+                g->covers[n.first].push_back({ i, n.second });
+            }
+            g->index.insert({ hash_row(V[i]), i });
+        }
+        return g;
+    }
+
+    // The gain of adding x to the current solution
+    accum_t gain(vector<data_t> const& x) const {
+        accum_t g = 0;
+        if (ground->sparse) {
+            for (auto const& c : ground->covers[ground->find(x)]) {
+                if (c.second > best[c.first]) g += c.second - best[c.first];
+            }
+        }
+        else {
+            long N = static_cast<long>(best.size());
+            data_t const* xp = x.data();
+            #pragma omp parallel for reduction(+:g) schedule(static) if(N >= PARALLEL_THRESHOLD)
+            for (long i = 0; i < N; ++i) {
+                data_t s = ground->similarity(i, xp);
+                if (s > best[i]) g += s - best[i];
+            }
+        }
+        return g;
+    }
+
+    // Computes the best similarities of the solution S from scratch and returns f(S)
+    accum_t evaluate(SolutionView const& S, vector<data_t>& out) const {
+        fill(out.begin(), out.end(), data_t(0));
+        if (ground->sparse) {
+            for (auto const& s : S) {
+                for (auto const& c : ground->covers[ground->find(s)]) {
+                    out[c.first] = max(out[c.first], c.second);
+                }
+            }
+        }
+        else {
+            long N = static_cast<long>(out.size());
+            #pragma omp parallel for schedule(static) if(N >= PARALLEL_THRESHOLD)
+            for (long i = 0; i < N; ++i) {
+                for (auto const& s : S) {
+                    out[i] = max(out[i], ground->similarity(i, s.data()));
+                }
+            }
+        }
+        accum_t f = 0;
+        for (auto b : out) f += b;
+        return f;
+    }
+
+public:
+    /**
+     * @brief  Creates a dense facility location function.
+     * @param  V: The ground set, which is copied.
+     * @param  kernel: The (non-negative) similarity.
+     */
+    FacilityLocation(vector<vector<data_t>> const& V, Kernel const& kernel)
+        : FacilityLocation(make_ground_set(V, kernel)) {}
+
+    /**
+     * @brief  Creates a sparse facility location function on the k-nearest-neighbor graph
+            of V. Building the graph costs O(|V|^2 * D) once.
+     * @param  V: The ground set, which is copied.
+     * @param  kernel: The (non-negative) similarity.
+     * @param  k: Number of most similar elements (including itself) every element
+            of V is connected to.
+     */
+    FacilityLocation(vector<vector<data_t>> const& V, Kernel const& kernel, size_t k)
+        : FacilityLocation(make_sparse_ground_set(V, kernel, k)) {}
+
+    data_t peek(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        if (pos >= cur_solution.size()) {
+            return fval + gain(x);
+        }
+        vector<data_t> tmp(best.size());
+        return evaluate(SolutionView(cur_solution, x, pos), tmp);
+    }
+
+    void update(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        if (pos < cur_solution.size()) {
+            fval = evaluate(SolutionView(cur_solution, x, pos), best);
+            return;
+        }
+
+        if (ground->sparse) {
+            for (auto const& c : ground->covers[ground->find(x)]) {
+                if (c.second > best[c.first]) {
+                    fval += c.second - best[c.first];
+                    best[c.first] = c.second;
+                }
+            }
+        }
+        else {
+            long N = static_cast<long>(best.size());
+            data_t const* xp = x.data();
+            accum_t g = 0;
+            #pragma omp parallel for reduction(+:g) schedule(static) if(N >= PARALLEL_THRESHOLD)
+            for (long i = 0; i < N; ++i) {
+                data_t s = ground->similarity(i, xp);
+                if (s > best[i]) {
+                    g += s - best[i];
+                    best[i] = s;
+                }
+            }
+            fval += g;
+        }
+    }
+
+    data_t operator()(vector<vector<data_t>> const& cur_solution) const override {
+        vector<data_t> tmp(best.size());
+        return evaluate(SolutionView(cur_solution), tmp);
+    }
+
+    // The state has the size of the ground set and is always written in full
+    void save(BinaryWriter& out, unsigned int from = 0) const override {
+        out.write<accum_t>(fval);
+        out.write_vector(best);
+    }
+
+    void load(BinaryReader& in, unsigned int from = 0) override {
+        fval = in.read<accum_t>();
+        vector<data_t> b = in.read_vector<data_t>();
+        if (b.size() != best.size()) {
+            throw runtime_error("FacilityLocation::load: The checkpoint was written for a different ground set.");
+        }
+        best = move(b);
+    }
+
+    // The ground set and the similarity graph are shared between all clones and not counted
+    size_t get_memory_bytes() const override {
+        return sizeof(FacilityLocation) + best.capacity() * sizeof(data_t);
+    }
+
+    shared_ptr<SubmodularFunction> clone() const override {
+        return shared_ptr<SubmodularFunction>(new FacilityLocation(ground));
+    }
+};
+
+#endif // FACILITY_LOCATION_H
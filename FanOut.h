@@ -0,0 +1,264 @@
+#ifndef FAN_OUT_H
+#define FAN_OUT_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <condition_variable>
+
+#include "DataTypeHandling.h"
+#include "SubmodularOptimizer.h"
+#include "DataSource.h"
+#include "Dataset.h"
+#include "KernelCache.h"
+
+using namespace std;
+
+/**
+ * @brief  Reads a stream once and offers every element to many streaming optimizers,
+        e.g. SieveStreaming and SieveStreamingPP for several epsilon. Elements are
+        collected into batches. Every batch is processed by a pool of worker threads,
+        where each worker takes the next optimizer which has not seen the batch yet
+        and passes all elements of the batch to its next() in stream order. Hence,
+        every optimizer sees exactly the same sequence of next() calls as if it
+        consumed the stream on its own.
+
+        The FanOut owns a KernelCache with one slot per element of a batch. Functions
+        which share it (see FastIVM::share_kernel_cache) evaluate the kernel of an
+        element and a stored element only once for all optimizers, which is most of
+        the kernel work of a parameter sweep. Results are identical with and without
+        the cache.
+ * @note   Only streaming optimizers can be used, i.e. not Greedy.
+ */
+class FanOut {
+protected:
+    vector<unique_ptr<SubmodularOptimizer>> optimizers;
+    shared_ptr<KernelCache> cache;
+    size_t batch_size;
+    unsigned int num_threads;
+
+    // The current batch, the first element has the stream position `position'
+    vector<vector<data_t>> batch;
+    vector<optional<idx_t>> batch_ids;
+    size_t batch_length = 0;
+    uint64_t position = 0;
+
+    // Worker pool
+    vector<thread> workers;
+    mutex lock;
+    condition_variable work_available;
+    condition_variable work_done;
+    uint64_t generation = 0;
+    unsigned int busy = 0;
+    bool stop = false;
+    atomic<size_t> next_optimizer;
+    exception_ptr error;
+
+    // Passes the current batch to optimizers until none is left
+    void drain() {
+        try {
+            size_t o;
+            while ((o = next_optimizer.fetch_add(1)) < optimizers.size()) {
+                for (size_t i = 0; i < batch_length; ++i) {
+                    KernelCache::Scope scope(position + i);
+                    optimizers[o]->next(batch[i], batch_ids[i]);
+                }
+            }
+        }
+        catch (...) {
+            lock_guard<mutex> guard(lock);
+            if (!error) error = current_exception();
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(lock);
+                work_available.wait(guard, [&]() { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            drain();
+            {
+                lock_guard<mutex> guard(lock);
+                --busy;
+            }
+            work_done.notify_all();
+        }
+    }
+
+    void process_batch() {
+        if (batch_length == 0) return;
+        cache->reset(position);
+        next_optimizer.store(0);
+
+        if (!workers.empty()) {
+            {
+                lock_guard<mutex> guard(lock);
+                busy = workers.size();
+                ++generation;
+            }
+            work_available.notify_all();
+        }
+        // The calling thread works as well
+        drain();
+        if (!workers.empty()) {
+            unique_lock<mutex> guard(lock);
+            work_done.wait(guard, [&]() { return busy == 0; });
+        }
+
+        position += batch_length;
+        batch_length = 0;
+        if (error) {
+            exception_ptr e = error;
+            error = nullptr;
+            rethrow_exception(e);
+        }
+    }
+
+public:
+    /**
+     * @brief  Creates a new fan-out.
+     * @param  num_threads: Number of threads including the calling one, 0 uses one per
+            hardware thread. There is no point in using more threads than optimizers.
+     * @param  batch_size: Number of elements which are processed at once. Larger batches
+            mean less synchronization between the threads, but more memory for the
+            batch and the kernel cache.
+     */
+    FanOut(unsigned int num_threads = 0, size_t batch_size = 256)
+        : batch_size(batch_size), batch(batch_size), batch_ids(batch_size), next_optimizer(0) {
+        if (batch_size == 0) {
+            throw runtime_error("FanOut: The batch size must be positive.");
+        }
+        if (num_threads == 0) {
+            num_threads = max(1u, thread::hardware_concurrency());
+        }
+        this->num_threads = num_threads;
+        cache = make_shared<KernelCache>(batch_size, num_threads > 1);
+        for (unsigned int i = 1; i < num_threads; ++i) {
+            workers.emplace_back(&FanOut::work, this);
+        }
+    }
+
+    FanOut(FanOut const&) = delete;
+    FanOut& operator=(FanOut const&) = delete;
+
+    /**
+     * @brief  The kernel cache of this fan-out. Pass it to the function before the
+            optimizers are created, e.g. FastIVM::share_kernel_cache(), so that all
+            clones use it.
+     */
+    inline shared_ptr<KernelCache> get_kernel_cache() const { return cache; }
+
+    /**
+     * @brief  Adds an optimizer. Elements which were already consumed are not replayed.
+     * @param  opt: The optimizer, which is owned by this fan-out.
+     * @retval A reference to the optimizer, e.g. to read its solution after the stream ended.
+     */
+    SubmodularOptimizer& add(unique_ptr<SubmodularOptimizer> opt) {
+        flush();
+        optimizers.push_back(move(opt));
+        return *optimizers.back();
+    }
+
+    // Constructs an optimizer of the given type in place, see add()
+    template <typename Optimizer, typename... Args>
+    Optimizer& emplace(Args&&... args) {
+        auto opt = new Optimizer(forward<Args>(args)...);
+        add(unique_ptr<SubmodularOptimizer>(opt));
+        return *opt;
+    }
+
+    inline size_t size() const { return optimizers.size(); }
+
+    inline unsigned int get_num_threads() const { return num_threads; }
+
+    inline SubmodularOptimizer& operator[](size_t i) { return *optimizers[i]; }
+
+    inline SubmodularOptimizer const& operator[](size_t i) const { return *optimizers[i]; }
+
+    /**
+     * @brief  Consumes the next element of the stream. The optimizers see it once the
+            batch is full or flush() is called.
+     * @param  x: A constant reference to the next object on the stream.
+     * @param  id: The id of x.
+     */
+    void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+        batch[batch_length].assign(x.begin(), x.end());
+        batch_ids[batch_length] = id;
+        if (++batch_length == batch_size) {
+            process_batch();
+        }
+    }
+
+    // Passes all buffered elements to the optimizers
+    void flush() {
+        process_batch();
+    }
+
+    /**
+     * @brief  Passes all buffered elements to the optimizers and then tells every optimizer
+            that the following elements are sampled, see
+            SubmodularOptimizer::set_sampling_probability().
+     */
+    void set_sampling_probability(data_t p) {
+        flush();
+        for (auto& opt : optimizers) {
+            opt->set_sampling_probability(p);
+        }
+    }
+
+    /**
+     * @brief  Passes the entire data set once to every optimizer.
+     * @param  X: A constant reference to the entire data set.
+     * @param  ids: The ids of the rows in X, may be empty.
+     */
+    void fit(vector<vector<data_t>> const& X, vector<idx_t> const& ids = {}) {
+        for (size_t i = 0; i < X.size(); ++i) {
+            next(X[i], i < ids.size() ? optional<idx_t>(ids[i]) : nullopt);
+        }
+        flush();
+    }
+
+    void fit(DatasetView const& X, vector<idx_t> const& ids = {}) {
+        vector<data_t> x;
+        for (size_t i = 0; i < X.size(); ++i) {
+            x.assign(X.row(i), X.row(i) + X.dimension());
+            next(x, i < ids.size() ? optional<idx_t>(ids[i]) : nullopt);
+        }
+        flush();
+    }
+
+    /**
+     * @brief  Consumes an entire (possibly unbounded) stream, see SubmodularOptimizer::fit(DataSource&).
+     */
+    void fit(DataSource& source) {
+        vector<data_t> x;
+        idx_t id;
+        while (source.next(x, id)) {
+            next(x, id);
+        }
+        flush();
+    }
+
+    ~FanOut() {
+        {
+            lock_guard<mutex> guard(lock);
+            stop = true;
+        }
+        work_available.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+};
+
+#endif // FAN_OUT_H
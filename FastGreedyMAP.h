@@ -0,0 +1,190 @@
+#ifndef FAST_GREEDY_MAP_H
+#define FAST_GREEDY_MAP_H
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "DataTypeHandling.h"
+#include "SubmodularOptimizer.h"
+#include "FastIVM.h"
+#include "RowHash.h"
+
+using namespace std;
+
+/**
+ * @brief  Greedy maximization of the log-det objective of FastIVM, following the fast
+        greedy MAP inference for DPPs of Chen et al. (2018). Greedy + FastIVM computes
+        the kernel row of every candidate against the entire solution and its Cholesky
+        row by a full forward substitution in every round. Here every candidate keeps
+        its Cholesky row across the rounds, and each round only appends a single entry
+        to it: one kernel evaluation against the element selected last and one inner
+        product of length K.
+ *  - Stream:  No
+ *  - Solution: 1 - exp(1)
+ *  - Runtime: O(N * K * (D + K)) instead of O(N * K * (K * D + K^2))
+ *  - Memory: O(N * K) for the Cholesky rows of all candidates
+ *  - Function Queries per Element: none, the kernel is evaluated directly
+ *  - Function Types: FastIVM
+ *
+ *  All entries are computed with exactly the same operations as FastIVM::peek, thus
+ *  the selected elements and the function value are identical to Greedy + FastIVM.
+ *
+ * See also :
+ *   - Chen, L., Zhang, G., & Zhou, E. (2018). Fast greedy MAP inference for determinantal point process to improve recommendation diversity. NeurIPS 2018.
+ * @note
+ */
+class FastGreedyMAP : public SubmodularOptimizer {
+protected:
+    shared_ptr<Kernel> kernel;
+    data_t sigma;
+    bool robust;
+
+    template <typename RowAt>
+    void fit_rows(size_t N, RowAt row_at, vector<idx_t> const& ids) {
+        MetricsScope scope(metrics);
+
+        vector<unsigned int> remaining(N);
+        iota(remaining.begin(), remaining.end(), 0);
+
+        // Same duplicate handling as Greedy::fit
+        vector<uint64_t> hashes;
+        if (duplicates) {
+            hashes.resize(N);
+            for (size_t i = 0; i < N; ++i) {
+                hashes[i] = hash_row(row_at(i));
+            }
+            remaining.erase(remove_if(remaining.begin(), remaining.end(),
+                [&](unsigned int i) { return duplicates->check(hashes[i]); }
+            ), remaining.end());
+        }
+
+        unsigned int rounds = static_cast<unsigned int>(min<size_t>(K, remaining.size()));
+        // C[i * K + j] is the entry j of the Cholesky row of candidate i
+        vector<accum_t> C(N * K);
+        vector<accum_t> diag(N);
+        for (auto i : remaining) {
+            data_t kval = kernel->operator()(row_at(i), row_at(i));
+            diag[i] = 1.0 + kval / pow(sigma, 2.0);
+        }
+
+        // The pivots of the selected elements, i.e. the diagonal of FastIVM's L
+        vector<accum_t> pivots;
+        accum_t fcur = 0;
+        unsigned int last = 0;
+        vector<data_t> fvals;
+
+        for (unsigned int r = 0; r < rounds; ++r) {
+            fvals.clear();
+            fvals.reserve(remaining.size());
+            accum_t const* c_last = &C[last * K];
+
+            for (auto i : remaining) {
+                accum_t* c = &C[i * K];
+                if (r > 0) {
+                    // Append entry r - 1 to the Cholesky row of i, see FastIVM::peek
+                    data_t kval = kernel->operator()(solution[r - 1], row_at(i));
+                    accum_t kmat = kval / pow(sigma, 2.0);
+                    accum_t s = inner_product(c, c + r - 1, c_last, static_cast<accum_t>(0));
+                    c[r - 1] = (1.0f / pivots[r - 1] * (kmat - s));
+                }
+                accum_t s = inner_product(c, c + r, c, static_cast<accum_t>(0));
+                accum_t pivot = diag[i] - s;
+                if (robust && !(pivot > FastIVM::MIN_PIVOT)) {
+                    fvals.push_back(fcur);
+                }
+                else {
+                    fvals.push_back(fcur + 2.0 * log(sqrt(pivot)));
+                }
+            }
+
+            unsigned int max_ele = distance(fvals.begin(), max_element(fvals.begin(), fvals.end()));
+            unsigned int max_idx = remaining[max_ele];
+            fcur = fvals[max_ele];
+
+            accum_t const* c = &C[max_idx * K];
+            accum_t pivot = diag[max_idx] - inner_product(c, c + r, c, static_cast<accum_t>(0));
+            pivots.push_back(robust && !(pivot > FastIVM::MIN_PIVOT) ? sqrt(FastIVM::MIN_PIVOT) : sqrt(pivot));
+
+            vector<data_t> const& x = row_at(max_idx);
+            {
+                // Keeps f in the same state as after Greedy + FastIVM
+                MetricTimer timer(MetricEvent::update);
+                f->update(solution, x, solution.size());
+            }
+            solution.push_back(x);
+            prefix_fvals.push_back(fcur);
+            this->ids.push_back(ids.size() > max_idx ? ids[max_idx] : static_cast<idx_t>(max_idx));
+            last = max_idx;
+
+            remaining.erase(remaining.begin() + max_ele);
+            if (duplicates) {
+                duplicates->accept(hashes[max_idx]);
+                if (duplicates->get_mode() == DuplicateMode::accepted) {
+                    remaining.erase(remove_if(remaining.begin(), remaining.end(),
+                        [&](unsigned int i) { return hashes[i] == hashes[max_idx]; }
+                    ), remaining.end());
+                    rounds = min(rounds, static_cast<unsigned int>(r + 1 + remaining.size()));
+                }
+            }
+        }
+
+        fval = fcur;
+        is_fitted = true;
+        publish_snapshot();
+    }
+
+public:
+    /**
+     * @brief Construct a new FastGreedyMAP object
+     *
+     * @param K The cardinality constraint, that is the number of items selected.
+     * @param f The log-det objective. Its kernel, sigma and robust mode are used and it is
+            cloned, so that get_solution() comes with a FastIVM in the same state as
+            after Greedy + FastIVM.
+     */
+    FastGreedyMAP(unsigned int K, FastIVM& f)
+        : SubmodularOptimizer(K, static_cast<SubmodularFunction&>(f)), kernel(f.get_kernel().clone()), sigma(f.get_sigma()), robust(f.is_robust()) {
+        // A FastIVM must not end up in the std::function wrapper, whose update() does nothing
+        if (!dynamic_pointer_cast<FastIVM>(this->f)) {
+            throw runtime_error("FastGreedyMAP: The clone of f is no FastIVM, please check FastIVM::clone().");
+        }
+    }
+
+    /**
+     * @brief Construct a new FastGreedyMAP object for FastIVM(K, kernel, sigma).
+     */
+    FastGreedyMAP(unsigned int K, Kernel const& kernel, data_t sigma)
+        : FastGreedyMAP(K, *make_shared<FastIVM>(K, kernel, sigma)) {}
+
+    void fit(vector<vector<data_t>> const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        fit_rows(X.size(), [&X](size_t i) -> vector<data_t> const& { return X[i]; }, ids);
+    }
+
+    void fit(DatasetView const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        vector<data_t> x;
+        fit_rows(X.size(), [&X, &x](size_t i) -> vector<data_t> const& {
+            x.assign(X.row(i), X.row(i) + X.dimension());
+            return x;
+        }, ids);
+    }
+
+    void fit(DatasetView const& X, unsigned int iterations = 1) {
+        vector<idx_t> ids;
+        fit(X, ids, iterations);
+    }
+
+    void fit(vector<vector<data_t>> const& X, unsigned int iterations = 1) {
+        vector<idx_t> ids;
+        fit(X, ids, iterations);
+    }
+
+    void next(vector<data_t> const& x, optional<idx_t> id = nullopt) {
+        throw runtime_error("FastGreedyMAP does not support streaming data, please use fit().");
+    }
+};
+
+#endif // FAST_GREEDY_MAP_H
@@ -7,61 +7,149 @@
 #include <math.h>
 #include <cassert>
 #include <numeric>
+#include <string>
+#include <stdexcept>
+#include <limits>
 
 #include "DataTypeHandling.h"
 #include "SubmodularFunction.h"
 #include "IVM.h"
+#include "KernelCache.h"
 
 
+/*
+* FastIVM keeps the kernel matrix and its Cholesky factor of the current solution, so
+* that peeking at an appended element only computes one new row in O(K * D + K^2).
+* Both are stored as TriangularMatrix and grow with the solution, i.e. a function
+* holding n elements needs O(n^2) memory instead of O(K^2). This matters for the
+* many sieves of SieveStreaming(PP), most of which never hold more than a few elements.
+*
+* In robust mode pivots of the Cholesky factor which are not larger than MIN_PIVOT
+* (e.g. because of rounding errors for near-duplicate rows, or a kernel which is not
+* positive definite) are clamped to MIN_PIVOT. A clamped pivot adds nothing to the log-det,
+* i.e. an appended element with such a pivot has a gain of zero, and the same rule applies
+* when the factor is recomputed after a replacement. For a positive definite kernel every pivot is at least 1, because
+* of the identity added to the kernel matrix. Without it, the pivot can become
+* non-positive and the resulting NaN function values silently break all comparisons
+* of the optimizers.
+*/
 class FastIVM : public IVM {
 private:
 
 protected:
+    unsigned int K;
     unsigned int added;
-    Matrix kmat;
-    Matrix L;
-    data_t fval;
+    // Lower triangles of the kernel matrix and its Cholesky factor. Row `added' is the
+    // scratch row of the last peek
+    TriangularMatrix kmat;
+    TriangularMatrix L;
+    accum_t fval;
+    bool robust;
+
+    // peek_with_threshold only stops early if the bound is below threshold by this relative margin
+    static constexpr accum_t THRESHOLD_SLACK = 1e-9;
+
+    // Kernel values shared with other functions, see share_kernel_cache()
+    shared_ptr<KernelCache> cache;
+    // The stream position of every element of the solution, see KernelCache. Grows with kmat and L
+    vector<uint64_t> tags;
+
+    // The log-det from the first `added' rows of a Cholesky factor. In robust mode clamped
+    // pivots count as zero, like on append, instead of log(MIN_PIVOT)
+    inline accum_t log_det_from_factor(TriangularMatrix const& factor) const {
+        if (!robust) return log_det_from_cholesky(factor, added);
+        accum_t det = 0;
+        for (unsigned int i = 0; i < added; ++i) {
+            if (factor(i, i) > sqrt(MIN_PIVOT)) det += log(factor(i, i));
+        }
+        return 2 * det;
+    }
+
+    inline data_t cached_kernel(uint64_t tag, vector<data_t> const& s, vector<data_t> const& x) const {
+        if (!cache) return kernel->operator()(s, x);
+        return cache->get(tag, [&]() { return kernel->operator()(s, x); });
+    }
 
 public:
-    FastIVM(unsigned int K, Kernel const& kernel, data_t sigma) : IVM(kernel, sigma), kmat(K + 1), L(K + 1) {
+    // The smallest pivot in robust mode
+    static constexpr accum_t MIN_PIVOT = 1e-10;
+
+    FastIVM(unsigned int K, Kernel const& kernel, data_t sigma, bool robust = false)
+        : IVM(kernel, sigma), K(K), robust(robust) {
         added = 0;
         fval = 0;
     }
 
-    FastIVM(unsigned int K, function<data_t(vector<data_t> const&, vector<data_t> const&)> kernel, data_t sigma)
-        : IVM(kernel, sigma), kmat(K + 1), L(K + 1) {
+    FastIVM(unsigned int K, function<data_t(vector<data_t> const&, vector<data_t> const&)> kernel, data_t sigma, bool robust = false)
+        : IVM(kernel, sigma), K(K), robust(robust) {
         added = 0;
         fval = 0;
     }
 
     data_t peek(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        return peek_with_threshold(cur_solution, x, pos, -numeric_limits<data_t>::infinity());
+    }
+
+    /**
+     * @brief  Appending x changes the log-det by log(p), where p is the last pivot of the
+            Cholesky factor. While the new row of L is computed, kmat(added, added) minus the
+            squares of the entries computed so far is an upper bound of p which only
+            decreases. Once this bound shows that the function value stays below threshold,
+            the remaining kernel evaluations and inner products are skipped. The bound
+            itself costs a single kernel evaluation k(x, x), so e.g. sieves whose
+            threshold exceeds the largest possible gain reject x in O(D).
+     */
+    data_t peek_with_threshold(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos, data_t threshold) override {
         if (pos >= added) {
             // Peek function value for last line
-
-            for (unsigned int i = 0; i < added; ++i) {
-                data_t kval = kernel->operator()(cur_solution[i], x);
-
-                kmat(i, added) = kval / pow(sigma, 2.0);
-                kmat(added, i) = kval / pow(sigma, 2.0);
+            if (kmat.size() <= added) {
+                kmat.resize(added + 1);
+                L.resize(added + 1);
+                tags.resize(added + 1, KernelCache::NO_TAG);
             }
-            data_t kval = kernel->operator()(x, x);
+            data_t kval = cached_kernel(KernelCache::current(), x, x);
             kmat(added, added) = 1.0 + kval / pow(sigma, 2.0);
 
-            for (size_t j = 0; j <= added; j++) {
+            // The pivot has to be at least min_pivot for the function value to reach the threshold.
+            // In robust mode a tiny pivot means a gain of zero, so only thresholds above fval can be checked.
+            bool check = threshold > -numeric_limits<data_t>::infinity() && (!robust || threshold > fval);
+            accum_t min_pivot = check ? exp(threshold - fval) * (1.0 - THRESHOLD_SLACK) : 0;
+            accum_t pivot_bound = kmat(added, added);
+            auto rejected = [&]() -> data_t {
+                return pivot_bound > 0 ? fval + log(pivot_bound) : -numeric_limits<data_t>::infinity();
+            };
+            if (check && pivot_bound < min_pivot) {
+                return rejected();
+            }
+
+            for (size_t j = 0; j < added; j++) {
+                data_t kval = cached_kernel(tags[j], cur_solution[j], x);
+                kmat(added, j) = kval / pow(sigma, 2.0);
+
                 //data_t s = std::inner_product(&L[added * K], &L[added * K] + j, &L[j * K], static_cast<data_t>(0));
-                data_t s = inner_product(&L(added, 0), &L(added, j), &L(j, 0), static_cast<data_t>(0));
-                if (added == j) {
-                    L(added, j) = sqrt(kmat(added, j) - s);
-                }
-                else {
-                    L(added, j) = (1.0f / L(j, j) * (kmat(added, j) - s));
+                accum_t s = inner_product(&L(added, 0), &L(added, j), &L(j, 0), static_cast<accum_t>(0));
+                L(added, j) = (1.0f / L(j, j) * (kmat(added, j) - s));
+
+                if (check) {
+                    pivot_bound -= L(added, j) * L(added, j);
+                    if (pivot_bound < min_pivot) {
+                        return rejected();
+                    }
                 }
-                L(j, added) = L(added, j); // Symmetric update
             }
+
+            accum_t s = inner_product(&L(added, 0), &L(added, added), &L(added, 0), static_cast<accum_t>(0));
+            accum_t pivot = kmat(added, added) - s;
+            if (robust && !(pivot > MIN_PIVOT)) {
+                // Keep L invertible in case x is added anyway, but x does not add anything
+                L(added, added) = sqrt(MIN_PIVOT);
+                return fval;
+            }
+            L(added, added) = sqrt(pivot);
             return fval + 2.0 * log(L(added, added));
         }
         else {
-            Matrix tmp(kmat, added);
+            TriangularMatrix tmp(kmat, added);
             for (unsigned int i = 0; i < cur_solution.size(); ++i) {
                 if (i == pos) {
                     data_t kval = kernel->operator()(x, x);
@@ -69,12 +157,13 @@ public:
                 }
                 else {
                     data_t kval = kernel->operator()(cur_solution[i], x);
-                    tmp(i, pos) = kval / pow(sigma, 2.0);
-                    tmp(pos, i) = kval / pow(sigma, 2.0);
+                    tmp(max(i, pos), min(i, pos)) = kval / pow(sigma, 2.0);
                 }
             }
 
-            return log_det(tmp);
+            TriangularMatrix Ltmp(added);
+            cholesky(tmp, added, Ltmp, robust ? MIN_PIVOT : 0);
+            return log_det_from_factor(Ltmp);
         }
     }
 
@@ -82,6 +171,7 @@ public:
         if (pos >= added) {
             // We often have the peek () -> update() pattern. This call can be optimized since we now basically peek twice
             fval = peek(cur_solution, x, pos);
+            tags[added] = KernelCache::current();
             added++;
         }
         else {
@@ -92,12 +182,12 @@ public:
                 }
                 else {
                     data_t kval = kernel->operator()(cur_solution[i], x);
-                    kmat(i, pos) = kval / pow(sigma, 2.0);
-                    kmat(pos, i) = kval / pow(sigma, 2.0);
+                    kmat(max(i, pos), min(i, pos)) = kval / pow(sigma, 2.0);
                 }
             }
-            L = cholesky(kmat, added);
-            fval = log_det_from_cholesky(L);
+            tags[pos] = KernelCache::current();
+            cholesky(kmat, added, L, robust ? MIN_PIVOT : 0);
+            fval = log_det_from_factor(L);
         }
 
     }
@@ -106,10 +196,75 @@ public:
         return fval;
     }
 
+    /**
+     * @brief  Writes the rows from, ..., added - 1 of the kernel matrix and of its
+            Cholesky factor (lower triangles only), so restoring does not evaluate
+            the kernel once. Rows of an appended element never change afterwards,
+            thus an incremental checkpoint only needs the rows added since the last one.
+     */
+    void save(BinaryWriter& out, unsigned int from = 0) const override {
+        if (from > added) {
+            throw runtime_error("FastIVM::save: The checkpoint covers more elements (" + to_string(from) + ") than this function holds (" + to_string(added) + ").");
+        }
+        out.write<uint32_t>(K);
+        out.write<uint32_t>(added);
+        out.write<accum_t>(fval);
+        for (unsigned int i = from; i < added; ++i) {
+            for (unsigned int j = 0; j <= i; ++j) out.write<accum_t>(kmat(i, j));
+            for (unsigned int j = 0; j <= i; ++j) out.write<accum_t>(L(i, j));
+        }
+    }
+
+    void load(BinaryReader& in, unsigned int from = 0) override {
+        unsigned int k = in.read<uint32_t>();
+        unsigned int new_added = in.read<uint32_t>();
+        if (k != K) {
+            throw runtime_error("FastIVM::load: The checkpoint was written for K = " + to_string(k) + ", but this function has K = " + to_string(K) + ".");
+        }
+        if (from > added || new_added < from || new_added > K) {
+            throw runtime_error("FastIVM::load: The checkpoint does not match the state of this function.");
+        }
+        if (kmat.size() < new_added) {
+            kmat.resize(new_added);
+            L.resize(new_added);
+            tags.resize(new_added, KernelCache::NO_TAG);
+        }
+
+        fval = in.read<accum_t>();
+        for (unsigned int i = from; i < new_added; ++i) {
+            for (unsigned int j = 0; j <= i; ++j) kmat(i, j) = in.read<accum_t>();
+            for (unsigned int j = 0; j <= i; ++j) L(i, j) = in.read<accum_t>();
+            tags[i] = KernelCache::NO_TAG;
+        }
+        added = new_added;
+    }
+
+    inline bool is_robust() const { return robust; }
+
+    /**
+     * @brief  Reads and writes the kernel values of appended elements through the given
+            cache, which is passed on to all clones. Used by FanOut to compute the
+            kernel value of an element and a stored element only once for all
+            optimizers. The function values do not change.
+     * @param  c: The cache, all functions sharing it must use the same kernel. nullptr
+            disables the cache.
+     */
+    void share_kernel_cache(shared_ptr<KernelCache> c) {
+        cache = c;
+    }
+
+    inline shared_ptr<KernelCache> get_kernel_cache() const { return cache; }
+
+    // Both matrices grow with the solution, see TriangularMatrix
+    size_t get_memory_bytes() const override {
+        return IVM::get_memory_bytes() - sizeof(IVM) + sizeof(FastIVM)
+            + kmat.get_memory_bytes() + L.get_memory_bytes() + tags.capacity() * sizeof(uint64_t);
+    }
+
     shared_ptr<SubmodularFunction> clone() const override {
-        // We want to store k elements. To allow for efficient peeking we will reserve space for K + 1 elements in kmat and L. 
-        // Thus we need to call the constructor with one element less
-        return make_shared<FastIVM>(kmat.size() - 1, *kernel, sigma);
+        auto copy = make_shared<FastIVM>(K, *kernel, sigma, robust);
+        copy->cache = cache;
+        return copy;
     }};
 
 #endif // FAST_IVM_H
\ No newline at end of file
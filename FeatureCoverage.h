@@ -0,0 +1,293 @@
+#ifndef FEATURE_COVERAGE_H
+#define FEATURE_COVERAGE_H
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "DataTypeHandling.h"
+#include "SubmodularFunction.h"
+
+using namespace std;
+
+/*
+* Sparse rows. The optimizers only know dense rows (vector<data_t>), so a sparse row
+* with the non-zero features (j_1, v_1), ..., (j_n, v_n) is passed around as the
+* interleaved vector
+*
+*      (j_1, v_1, j_2, v_2, ..., j_n, v_n)
+*
+* of length 2 * nnz. Feature indices are stored as data_t, so they are exact up to
+* 2^24 (float) or 2^53 (double) features.
+*/
+
+/**
+ * @brief  Encodes a sparse row.
+ * @param  indices: The indices of the non-zero features.
+ * @param  values: The values of the non-zero features.
+ * @retval The interleaved row.
+ */
+inline vector<data_t> make_sparse_row(vector<idx_t> const& indices, vector<data_t> const& values) {
+    if (indices.size() != values.size()) {
+        throw runtime_error("make_sparse_row: indices and values must have the same size.");
+    }
+    vector<data_t> row(2 * indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        row[2 * i] = static_cast<data_t>(indices[i]);
+        row[2 * i + 1] = values[i];
+    }
+    return row;
+}
+
+/**
+ * @brief  A sparse matrix in compressed sparse row (CSR) format, e.g. one row per
+        event and one column per feature.
+ */
+struct CSRMatrix {
+    size_t num_features = 0;
+    // Row i consists of the entries indptr[i], ..., indptr[i + 1] - 1
+    vector<size_t> indptr = { 0 };
+    vector<idx_t> indices;
+    vector<data_t> values;
+
+    inline size_t size() const { return indptr.size() - 1; }
+
+    inline size_t nnz() const { return indices.size(); }
+
+    // Appends a row, the feature indices must be < num_features
+    void push_back(vector<idx_t> const& row_indices, vector<data_t> const& row_values) {
+        if (row_indices.size() != row_values.size()) {
+            throw runtime_error("CSRMatrix::push_back: indices and values must have the same size.");
+        }
+        indices.insert(indices.end(), row_indices.begin(), row_indices.end());
+        values.insert(values.end(), row_values.begin(), row_values.end());
+        indptr.push_back(indices.size());
+    }
+
+    // Row i encoded as an interleaved sparse row
+    vector<data_t> row(size_t i) const {
+        vector<data_t> r(2 * (indptr[i + 1] - indptr[i]));
+        for (size_t k = indptr[i], l = 0; k < indptr[i + 1]; ++k, l += 2) {
+            r[l] = static_cast<data_t>(indices[k]);
+            r[l + 1] = values[k];
+        }
+        return r;
+    }
+
+    // All rows encoded as interleaved sparse rows, e.g. for SubmodularOptimizer::fit
+    vector<vector<data_t>> rows() const {
+        vector<vector<data_t>> X(size());
+        for (size_t i = 0; i < size(); ++i) {
+            X[i] = row(i);
+        }
+        return X;
+    }
+};
+
+/**
+ * @brief  The concave function g applied to the accumulated mass of every feature.
+ *      - sqrt: g(m) = sqrt(m)
+ *      - log1p: g(m) = log(1 + m)
+ *      - saturate: g(m) = min(m, cap), which for binary features and cap = 1 is
+ *        (weighted) set cover
+ */
+enum class Concave { sqrt, log1p, saturate };
+
+inline string to_string(Concave g) {
+    switch (g) {
+    case Concave::sqrt: return "sqrt";
+    case Concave::log1p: return "log1p";
+    case Concave::saturate: return "saturate";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief  The feature based ("concave over modular") coverage function
+ *
+ *      f(S) = sum_j w_j g(m_j(S)),   m_j(S) = sum_{s in S} s_j
+ *
+ *  over sparse rows with non-negative values, where g is a non-decreasing concave
+ *  function (see Concave) and w_j >= 0 the weight of feature j. It is monotone
+ *  submodular. The function keeps the mass m_j of every feature for the current
+ *  solution, so that peek and update only touch the non-zero features of x and
+ *  cost O(nnz(x)). Replacing an element (e.g. Random) additionally costs
+ *  O(nnz(replaced element)).
+ *
+ *  Rows are interleaved sparse rows, see make_sparse_row and CSRMatrix. The
+ *  weights are shared between all clones, every clone (e.g. every sieve of
+ *  SieveStreaming) allocates O(num_features) for its masses.
+ */
+class FeatureCoverage : public SubmodularFunction {
+protected:
+    shared_ptr<vector<data_t> const> weights;
+    Concave g;
+    data_t cap;
+
+    vector<accum_t> mass;
+    accum_t fval;
+
+    // The features touched by a replacement and their mass before it
+    vector<pair<idx_t, accum_t>> touched;
+    vector<bool> is_touched;
+
+    FeatureCoverage(shared_ptr<vector<data_t> const> weights, Concave g, data_t cap)
+        : weights(weights), g(g), cap(cap), mass(weights->size(), 0), fval(0), is_touched(weights->size(), false) {
+        if (cap <= 0) {
+            throw runtime_error("FeatureCoverage: cap must be positive.");
+        }
+    }
+
+    inline accum_t concave(accum_t m) const {
+        switch (g) {
+        case Concave::sqrt: return sqrt(m);
+        case Concave::log1p: return log1p(m);
+        case Concave::saturate: return min(m, static_cast<accum_t>(cap));
+        }
+        return m;
+    }
+
+    inline size_t feature(data_t j) const {
+        if (!(j >= 0 && j < mass.size())) {
+            throw runtime_error("FeatureCoverage: Feature index " + std::to_string(j) + " is out of range.");
+        }
+        return static_cast<size_t>(j);
+    }
+
+    // The gain of adding the sparse row x to the current masses
+    accum_t gain(vector<data_t> const& x) const {
+        accum_t delta = 0;
+        for (size_t k = 0; k + 1 < x.size(); k += 2) {
+            size_t j = feature(x[k]);
+            accum_t m = mass[j];
+            delta += (*weights)[j] * (concave(m + x[k + 1]) - concave(m));
+        }
+        return delta;
+    }
+
+    // Adds sign * x to the masses and remembers the previous mass of every feature
+    void apply(vector<data_t> const& x, accum_t sign) {
+        for (size_t k = 0; k + 1 < x.size(); k += 2) {
+            size_t j = feature(x[k]);
+            if (!is_touched[j]) {
+                is_touched[j] = true;
+                touched.push_back({ j, mass[j] });
+            }
+            // Masses are non-negative, subtracting might otherwise leave rounding noise
+            mass[j] = max(mass[j] + sign * x[k + 1], accum_t(0));
+        }
+    }
+
+    // Replaces old_x by x, returns the change of f
+    accum_t replace(vector<data_t> const& old_x, vector<data_t> const& x) {
+        apply(old_x, -1);
+        apply(x, 1);
+        accum_t delta = 0;
+        for (auto const& t : touched) {
+            delta += (*weights)[t.first] * (concave(mass[t.first]) - concave(t.second));
+        }
+        return delta;
+    }
+
+    // Forgets the touched features, optionally restoring their previous mass
+    void reset_touched(bool restore) {
+        for (auto const& t : touched) {
+            if (restore) mass[t.first] = t.second;
+            is_touched[t.first] = false;
+        }
+        touched.clear();
+    }
+
+public:
+    /**
+     * @brief  Creates a new feature coverage function with unit weights.
+     * @param  num_features: Number of features, every feature index must be smaller.
+     * @param  g: The concave function.
+     * @param  cap: The cap of Concave::saturate, ignored otherwise.
+     */
+    FeatureCoverage(size_t num_features, Concave g = Concave::sqrt, data_t cap = 1.0)
+        : FeatureCoverage(make_shared<vector<data_t> const>(num_features, data_t(1)), g, cap) {}
+
+    /**
+     * @brief  Creates a new weighted feature coverage function.
+     * @param  weights: The non-negative weight of every feature.
+     * @param  g: The concave function.
+     * @param  cap: The cap of Concave::saturate, ignored otherwise.
+     */
+    FeatureCoverage(vector<data_t> const& weights, Concave g = Concave::sqrt, data_t cap = 1.0)
+        : FeatureCoverage(make_shared<vector<data_t> const>(weights), g, cap) {
+        for (auto w : weights) {
+            if (w < 0) {
+                throw runtime_error("FeatureCoverage: The weights must be non-negative.");
+            }
+        }
+    }
+
+    data_t peek(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        if (pos >= cur_solution.size()) {
+            return fval + gain(x);
+        }
+        accum_t delta = replace(cur_solution[pos], x);
+        reset_touched(true);
+        return fval + delta;
+    }
+
+    void update(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        if (pos >= cur_solution.size()) {
+            for (size_t k = 0; k + 1 < x.size(); k += 2) {
+                size_t j = feature(x[k]);
+                accum_t m = mass[j] + x[k + 1];
+                fval += (*weights)[j] * (concave(m) - concave(mass[j]));
+                mass[j] = m;
+            }
+            return;
+        }
+        fval += replace(cur_solution[pos], x);
+        reset_touched(false);
+    }
+
+    data_t operator()(vector<vector<data_t>> const& cur_solution) const override {
+        vector<accum_t> m(mass.size(), 0);
+        for (auto const& s : cur_solution) {
+            for (size_t k = 0; k + 1 < s.size(); k += 2) {
+                m[feature(s[k])] += s[k + 1];
+            }
+        }
+        accum_t f = 0;
+        for (size_t j = 0; j < m.size(); ++j) {
+            if (m[j] > 0) f += (*weights)[j] * concave(m[j]);
+        }
+        return f;
+    }
+
+    // The state has the size of the feature space and is always written in full
+    void save(BinaryWriter& out, unsigned int from = 0) const override {
+        out.write<accum_t>(fval);
+        out.write_vector(mass);
+    }
+
+    void load(BinaryReader& in, unsigned int from = 0) override {
+        fval = in.read<accum_t>();
+        vector<accum_t> m = in.read_vector<accum_t>();
+        if (m.size() != mass.size()) {
+            throw runtime_error("FeatureCoverage::load: The checkpoint was written for a different number of features.");
+        }
+        mass = move(m);
+    }
+
+    // The weights are shared between all clones and not counted
+    size_t get_memory_bytes() const override {
+        return sizeof(FeatureCoverage) + mass.capacity() * sizeof(accum_t)
+            + touched.capacity() * sizeof(pair<idx_t, accum_t>) + is_touched.capacity() / 8;
+    }
+
+    shared_ptr<SubmodularFunction> clone() const override {
+        return shared_ptr<SubmodularFunction>(new FeatureCoverage(weights, g, cap));
+    }
+};
+
+#endif // FEATURE_COVERAGE_H
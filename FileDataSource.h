@@ -0,0 +1,128 @@
+#ifndef FILE_DATA_SOURCE_H
+#define FILE_DATA_SOURCE_H
+
+#include <istream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <memory>
+
+#include "DataTypeHandling.h"
+#include "DataSource.h"
+#include "DatasetLoader.h"
+
+using namespace std;
+
+// The text formats understood by StreamDataSource
+enum class DelimitedFormat { arff, csv };
+
+/**
+ * @brief  A DataSource which parses ARFF or CSV rows from an input stream line by
+        line, e.g. StreamDataSource(cin, options, DelimitedFormat::csv) to read from
+        stdin. The header is consumed in the constructor and columns are selected
+        exactly like load_arff / load_csv do. Lines with too few fields are skipped.
+        Ids are assigned consecutively.
+ */
+class StreamDataSource : public DataSource {
+protected:
+    istream& in;
+    char delimiter;
+    vector<int> col_map;
+    size_t D;
+
+    string line;
+    // The first CSV line if it already holds data (CSV without header)
+    bool pending = false;
+    idx_t cnt = 0;
+
+    // Strips a trailing '\r' and returns whether line holds data
+    inline bool prepare_line(char const*& b, char const*& e) {
+        b = line.data();
+        e = line.data() + line.size();
+        if (e > b && e[-1] == '\r') --e;
+        return DelimitedParser::is_data_line(b, e);
+    }
+
+public:
+    StreamDataSource(istream& in, DatasetLoaderOptions const& options = DatasetLoaderOptions(),
+        DelimitedFormat format = DelimitedFormat::arff) : in(in), delimiter(options.delimiter) {
+        vector<DatasetColumn> header;
+        char const* b;
+        char const* e;
+
+        if (format == DelimitedFormat::arff) {
+            string meta;
+            while (getline(in, line)) {
+                meta += line + "\n";
+                prepare_line(b, e);
+                b = DelimitedParser::skip_spaces(b, e);
+                if (e - b >= 5 && DelimitedParser::iequals(string(b, b + 5), "@data")) {
+                    break;
+                }
+            }
+            char const* data_begin;
+            header = parse_arff_header(meta.data(), meta.data() + meta.size(), data_begin);
+        }
+        else {
+            bool found = false;
+            while (!found && getline(in, line)) {
+                found = prepare_line(b, e);
+            }
+            if (found) {
+                vector<string> fields = DelimitedParser::split_fields(b, e, delimiter);
+                for (size_t i = 0; i < fields.size(); ++i) {
+                    header.push_back({ options.has_header ? fields[i] : to_string(i), true });
+                }
+                pending = !options.has_header;
+            }
+        }
+
+        col_map = DelimitedParser::select_columns(header, options, D);
+    }
+
+    // Number of columns of every element
+    inline size_t dimension() const { return D; }
+
+    bool next(vector<data_t>& x, idx_t& id) override {
+        x.resize(D);
+        char const* b;
+        char const* e;
+        while (pending || getline(in, line)) {
+            pending = false;
+            if (prepare_line(b, e) && DelimitedParser::parse_row(b, e, col_map, D, delimiter, x.data())) {
+                id = cnt++;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief  A StreamDataSource which owns the file it reads from.
+ */
+class FileDataSource : public StreamDataSource {
+private:
+    // Constructed before the StreamDataSource base, which reads the header
+    struct OpenFile {
+        ifstream file;
+        OpenFile(string const& path) : file(path) {
+            if (!file.is_open()) {
+                throw runtime_error("FileDataSource: Could not open " + path);
+            }
+        }
+    };
+
+    unique_ptr<OpenFile> opened;
+
+    FileDataSource(unique_ptr<OpenFile> opened, DatasetLoaderOptions const& options, DelimitedFormat format)
+        : StreamDataSource(opened->file, options, format), opened(move(opened)) {}
+
+public:
+    FileDataSource(string const& path, DatasetLoaderOptions const& options = DatasetLoaderOptions(),
+        DelimitedFormat format = DelimitedFormat::arff)
+        : FileDataSource(unique_ptr<OpenFile>(new OpenFile(path)), options, format) {}
+};
+
+#endif // FILE_DATA_SOURCE_H
@@ -4,6 +4,7 @@
 #include "DataTypeHandling.h"
 #include "SubmodularOptimizer.h"
 #include <algorithm>
+#include <limits>
 #include <numeric>
 #include <iterator>
 
@@ -19,7 +20,7 @@ using namespace std;
  *  - Function Types: nonnegative submodular functions
  *
  * See also :
- *   - Nemhauser, G. L., Wolsey, L. A., & Fisher, M. L. (1978). An analysis of approximations for maximizing submodular set functions-I. Mathematical Programming, 14(1), 265C294. https://doi.org/10.1007/BF01588971
+ *   - Nemhauser, G. L., Wolsey, L. A., & Fisher, M. L. (1978). An analysis of approximations for maximizing submodular set functions-I. Mathematical Programming, 14(1), 265–294. https://doi.org/10.1007/BF01588971
  * @note
  */
 class Greedy : public SubmodularOptimizer {
@@ -43,39 +44,58 @@ public:
     Greedy(unsigned int K, function<data_t(vector<vector<data_t>> const&)> f) : SubmodularOptimizer(K, f) {}
 
 
+protected:
     /*
-    * @brief ݼѡӵ߼ԪءһֱظֱѡKԪء
-    *        'get_solution'õ
-    * @param X ݼĳá
-    * @param iterationsʵûʲôã̰㷨κݼϵKΡ
+    * @brief 在整个数据集中挑选拥有最大边际增益的元素。一直重复直到选择完K个元素。
+    *        调用'get_solution'得到结果。
+    * @param N 数据集中元素的个数。
+    * @param row_at 返回第i个元素的常引用，供vector<vector<data_t>>与DatasetView两种数据集共用。
     */
-    void fit(vector<vector<data_t>> const& X, vector<idx_t> const& ids,
-        unsigned int iterations = 1) {
+    template <typename RowAt>
+    void fit_rows(size_t N, RowAt row_at, vector<idx_t> const& ids) {
+        MetricsScope scope(metrics);
        
-        vector<unsigned int> remaining(X.size());//ݼʣδѡԪ
-        iota(remaining.begin(), remaining.end(), 0);//0,1,2...,X.size()-1
+        vector<unsigned int> remaining(N);//数据集中剩下未被选择的元素序号
+        iota(remaining.begin(), remaining.end(), 0);//0,1,2，...,N-1
         data_t fcur = 0;
 
+        // With a duplicate filter every row is hashed once. Duplicates of seen rows are
+        // never peeked at, duplicates of accepted rows are removed after each selection.
+        vector<uint64_t> hashes;
+        if (duplicates) {
+            hashes.resize(N);
+            for (size_t i = 0; i < N; ++i) {
+                hashes[i] = hash_row(row_at(i));
+            }
+            remaining.erase(remove_if(remaining.begin(), remaining.end(),
+                [&](unsigned int i) { return duplicates->check(hashes[i]); }
+            ), remaining.end());
+        }
+
         
-        while (solution.size() < K && remaining.size() > 0) {//KԪδѡꡢݼлʣԪ
-            vector<data_t> fvals;//ÿʣδѡԪرӽĺֵÿѡȡһֵ
-            fvals.reserve(remaining.size());//remaining.size()ÿѭֵС
+        while (solution.size() < K && remaining.size() > 0) {//K个元素未选择完、数据集中还剩余有元素
+            vector<data_t> fvals;//每个剩余未被选择元素被添加进解后的函数值，每次选取一个最大值
+            fvals.reserve(remaining.size());//共remaining.size()个，每次循环值会减小
 
             /*
-            * ̰㷨ѡ߼ԪءȼѡֵԪء
-            * ûҪʽټֵ
-            * pos = solution.size()pos>=solution.size()
-            * ftmpǼ轫X[i]ǰĺֵfvalsС
+            * 贪心算法挑选具有最大边际增益的元素。等价于挑选导致最大函数值的元素。
+            * 没必要再显式地再计算这个增长值。
+            * 由于pos = solution.size()，即pos>=solution.size()，
+            * 故ftmp就是假设将X[i]添加至当前解后的函数值。保存至数组fvals中。
             */
+            // Only elements which beat the best one so far matter, so f may reject the others early
+            data_t fbest = -numeric_limits<data_t>::infinity();
             for (auto i : remaining) {
-                data_t ftmp = f->peek(solution, X[i], solution.size());
+                MetricTimer timer(MetricEvent::peek);
+                data_t ftmp = f->peek_with_threshold(solution, row_at(i), solution.size(), fbest);
                 fvals.push_back(ftmp);
+                fbest = max(fbest, ftmp);
             }
 
             /*
-            * max_eleΪfvalsӵֵԪص±꣬ΧΪ[0,remaining.size()-1]remaining.size()==fvals.size()
-            * fcurΪǰֵֵ߼棬fcur-fcur(һ)=߼
-            * max_idxΪXеԪţΧΪ[0,X.size()-1]
+            * max_ele为fvals中拥有最大函数值的元素的下标，范围为[0,remaining.size()-1]，（remaining.size()==fvals.size()）
+            * fcur为当前的最大函数值，这个函数值导致了最大边际增益，即fcur-fcur(上一轮)=最大边际增益
+            * max_idx为X中的元素序号，范围为[0,N-1]
             */
             
             unsigned int max_ele = distance(fvals.begin(), max_element(fvals.begin(), fvals.end()));
@@ -83,27 +103,71 @@ public:
             unsigned int max_idx = remaining[max_ele];
 
             /*
-            * óֵ̰ѡԪءʽΪmax_idxԪӽǰ⣬
-            * ͬʱģи¡
+            * 得出了最大值，贪心选择该元素。故将序号为max_idx的元素添加进当前解，
+            * 同时，次模函数进行更新。
             */
-            f->update(solution, X[max_idx], solution.size());
-            solution.push_back(X[max_idx]);
+            vector<data_t> const& x = row_at(max_idx);
+            {
+                MetricTimer timer(MetricEvent::update);
+                f->update(solution, x, solution.size());
+            }
+            solution.push_back(x);
+            prefix_fvals.push_back(fcur);
 
             /*
-            * this->idsбÿһαѡԪ
+            * this->ids序列保存每一次被选择的元素序号
             */
             if (ids.size() >= max_idx) {
                 this->ids.push_back(max_idx);
             }
             /*
-            * ѡһԪأremainingȥ
+            * 挑选完一个元素，将其从remaining中移去
             */
             remaining.erase(remaining.begin() + max_ele);
 
+            if (duplicates) {
+                duplicates->accept(hashes[max_idx]);
+                if (duplicates->get_mode() == DuplicateMode::accepted) {
+                    remaining.erase(remove_if(remaining.begin(), remaining.end(),
+                        [&](unsigned int i) { return hashes[i] == hashes[max_idx]; }
+                    ), remaining.end());
+                }
+            }
+
         }
 
-        fval = fcur;//һĺֵ
+        fval = fcur;//最后一步的函数值
         is_fitted = true;
+        publish_snapshot();
+    }
+
+public:
+    /*
+    * @brief 在整个数据集中挑选拥有最大边际增益的元素。一直重复直到选择完K个元素。
+    *        调用'get_solution'得到结果。
+    * @param X 整个数据集的常引用。
+    * @param iterations：其实没什么用，贪心算法在任何情况下在整个数据集上迭代K次。
+    */
+    void fit(vector<vector<data_t>> const& X, vector<idx_t> const& ids,
+        unsigned int iterations = 1) {
+        fit_rows(X.size(), [&X](size_t i) -> vector<data_t> const& { return X[i]; }, ids);
+    }
+
+    /*
+    * @brief 同上，数据集以DatasetView给出（例如内存映射的二进制数据集）。
+    *        每次查询前将对应行复制到同一个缓冲区中，只有被选中的元素才会被复制进解。
+    */
+    void fit(DatasetView const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        vector<data_t> x;
+        fit_rows(X.size(), [&X, &x](size_t i) -> vector<data_t> const& {
+            x.assign(X.row(i), X.row(i) + X.dimension());
+            return x;
+        }, ids);
+    }
+
+    void fit(DatasetView const& X, unsigned int iterations = 1) {
+        vector<idx_t> ids;
+        fit(X, ids, iterations);
     }
 
     void fit(vector<vector<data_t>> const& X, unsigned int iterations = 1) {
@@ -118,7 +182,7 @@ public:
      * @param x A constant reference to the next object on the stream.
      */
      /*
-     * ʱ׳쳣Ϊ̰㷨֧ݡ
+     * 调用时抛出异常。因为这里贪心算法不支持流数据。
      */
     void next(vector<data_t> const& x, optional<idx_t> id = nullopt) {
         throw runtime_error("Greedy does not support streaming data, please use fit().");
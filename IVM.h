@@ -6,6 +6,7 @@
 #include <functional>
 #include <math.h>
 #include <cassert>
+#include <algorithm>
 #include "DataTypeHandling.h"
 #include "SubmodularFunction.h"
 #include "Kernel.h"
@@ -14,19 +15,20 @@
 using namespace std;
 
 /*
-* IVM֤ǵģ̳SubmodularFunctionࡣ
+* IVM被证明是单调次模函数。继承SubmodularFunction类。
 */
 class IVM : public SubmodularFunction {
 protected:
     /*
-    * ˾
-    * XǴĴ𰸼ͨkernel->operator()ԪؼƶȣתΪ˾󣨶Գ
-    * pow(1.0,2.0)=1趨Ĳ1
-    * ﻹһһλ󡣣i==jʱ˸1
+    * 计算核矩阵。
+    * X是传入的答案集。通过kernel->operator()计算元素间的相似度，最后转换为核矩阵（对称正定）
+    * pow(1.0,2.0)=1，这里设定的参数是1吧
+    * 这里还多了一步操作，即加上了一个单位矩阵。（i==j时多加了个1）
+    * The kernel matrix is written into the upper left block of mat, which must have
+    * at least X.size() rows.
     */
-    inline Matrix compute_kernel(vector<vector<data_t>> const& X) const {
+    inline void compute_kernel(SolutionView const& X, Matrix& mat) const {
         unsigned int K = X.size();
-        Matrix mat(K);
 
         for (unsigned int i = 0; i < K; ++i) {
             for (unsigned int j = i; j < K; ++j) {
@@ -40,49 +42,124 @@ protected:
                 }
             }
         }
+    }
 
-        // TODO CHECK IF THIS USES MOVE
+    inline Matrix compute_kernel(vector<vector<data_t>> const& X) const {
+        Matrix mat(X.size());
+        compute_kernel(SolutionView(X), mat);
         return mat;
     }
 
-    shared_ptr<Kernel> kernel;//õĵĺ˺
+    shared_ptr<Kernel> kernel;//所采用的的核函数
     data_t sigma;
 
+    /*
+    * Cache of the last evaluated solution: its rows, its kernel matrix and the Cholesky
+    * factor of the kernel matrix. A new solution which shares the first p rows with the
+    * cached one only needs the rows p, ..., N - 1 of both matrices, so appending an
+    * element (peek, update) costs O(K * D + K^2) instead of O(K^2 * D + K^3). If the
+    * prefix differs everything after it is recomputed. The cache is mutable so that
+    * operator() can use it as well, i.e. IVM objects must not be evaluated concurrently.
+    */
+    mutable vector<vector<data_t>> cached;
+    mutable unsigned int cached_size;
+    mutable Matrix kmat_cache;
+    mutable Matrix L_cache;
+
+    // Grows the cache matrices to at least N rows, keeping the first cached_size rows
+    void reserve_cache(unsigned int N) const {
+        unsigned int capacity = max(N, 2 * L_cache.size());
+        Matrix kmat(capacity), L(capacity);
+        for (unsigned int i = 0; i < cached_size; ++i) {
+            for (unsigned int j = 0; j <= i; ++j) {
+                kmat(i, j) = kmat(j, i) = kmat_cache(i, j);
+                L(i, j) = L_cache(i, j);
+            }
+        }
+        kmat_cache = move(kmat);
+        L_cache = move(L);
+        cached.resize(capacity);
+    }
+
+    // The log-det of the kernel matrix of X using (and updating) the cache
+    accum_t log_det_cached(SolutionView const& X) const {
+        unsigned int N = X.size();
+        unsigned int p = 0;
+        while (p < min(N, cached_size) && cached[p] == X[p]) {
+            ++p;
+        }
+        if (L_cache.size() < N) {
+            reserve_cache(N);
+        }
+
+        for (unsigned int i = p; i < N; ++i) {
+            cached[i].assign(X[i].begin(), X[i].end());
+
+            // Row i of the kernel matrix, see compute_kernel
+            for (unsigned int j = 0; j <= i; ++j) {
+                data_t kval = kernel->operator()(X[j], X[i]);
+                if (i == j) {
+                    kmat_cache(i, j) = 1.0 + kval / pow(1.0, 2.0);
+                }
+                else {
+                    kmat_cache(i, j) = kval / pow(1.0, 2.0);
+                    kmat_cache(j, i) = kval / pow(1.0, 2.0);
+                }
+            }
+
+            // Row i of the Cholesky factor, in the same order of operations as cholesky()
+            for (unsigned int j = 0; j <= i; ++j) {
+                accum_t sum = 0.0;
+                for (unsigned int k = 0; k < j; ++k) {
+                    sum += L_cache(i, k) * L_cache(j, k);
+                }
+                if (i == j) {
+                    L_cache(i, i) = sqrt(kmat_cache(i, i) - sum);
+                }
+                else {
+                    L_cache(i, j) = (kmat_cache(i, j) - sum) / L_cache(j, j);
+                }
+            }
+        }
+        cached_size = N;
+
+        return log_det_from_cholesky(L_cache, N);
+    }
+
 public:
-    IVM(Kernel const& kernel, data_t sigma) : kernel(kernel.clone()), sigma(sigma) {}
+    IVM(Kernel const& kernel, data_t sigma)
+        : kernel(kernel.clone()), sigma(sigma), cached_size(0), kmat_cache(0), L_cache(0) {}
 
     IVM(function<data_t(vector<data_t> const&, vector<data_t> const&)> kernel, data_t sigma)
-        : kernel(unique_ptr<Kernel>(new KernelWrapper(kernel))), sigma(sigma) {
+        : kernel(unique_ptr<Kernel>(new KernelWrapper(kernel))), sigma(sigma), cached_size(0), kmat_cache(0), L_cache(0) {
     }
 
     data_t peek(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
-        vector<vector<data_t>> tmp(cur_solution);
-
-        if (pos >= cur_solution.size()) {
-            tmp.push_back(x);
-        }
-        else {
-            tmp[pos] = x;
-        }
-
-        data_t ftmp = this->operator()(tmp);
+        data_t ftmp = log_det_cached(SolutionView(cur_solution, x, pos));
         return ftmp;
     }
 
-    void update(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {}
+    // Extends the cache by x, so that the next peek only has to compute one row
+    void update(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        log_det_cached(SolutionView(cur_solution, x, pos));
+    }
 
     data_t operator()(vector<vector<data_t>> const& X) const override {
-        // This is the most basic implementations which recomputes everything with each call
-        // I would not use this for any real-world problems. 
-
-        Matrix kernel_mat = compute_kernel(X);
-        return log_det(kernel_mat);
+        return log_det_cached(SolutionView(X));
     }
 
+    inline Kernel const& get_kernel() const { return *kernel; }
+
+    inline data_t get_sigma() const { return sigma; }
+
     shared_ptr<SubmodularFunction> clone() const override {
         return make_shared<IVM>(*kernel, sigma);
     }
 
+    size_t get_memory_bytes() const override {
+        return sizeof(IVM) + memory_bytes(cached) + kmat_cache.get_memory_bytes() + L_cache.get_memory_bytes();
+    }
+
     ~IVM() {}
 };
 
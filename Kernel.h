@@ -3,10 +3,11 @@
 
 #include <cassert>
 #include "DataTypeHandling.h"
+#include "Metrics.h"
 
 using namespace std;
 
-class Kernel {//˺
+class Kernel {//核函数基类
 
 public:
     virtual inline data_t operator()(const vector<data_t>& x1, const vector<data_t>& x2) const = 0;
@@ -26,6 +27,7 @@ public:
     KernelWrapper(function<data_t(vector<data_t> const&, vector<data_t> const&)> f) : f(f) {}
 
     inline data_t operator()(const vector<data_t>& x1, const vector<data_t>& x2) const override {
+        MetricTimer timer(MetricEvent::kernel);
         return f(x1, x2);
     }
 
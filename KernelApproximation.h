@@ -0,0 +1,248 @@
+#ifndef KERNEL_APPROXIMATION_H
+#define KERNEL_APPROXIMATION_H
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "DataTypeHandling.h"
+#include "Kernel.h"
+#include "Matrix.h"
+#include "Metrics.h"
+#include "Dataset.h"
+#include "DataSource.h"
+
+using namespace std;
+
+/*
+* Approximate kernels. A FeatureMap z maps a row x with D features to m features so
+* that k(x, y) ~ <z(x), z(y)>. Rows are projected once when they enter the system
+* (see FeatureMap::transform and ProjectedDataSource) and the optimizers then work
+* with DotProductKernel on the projected rows, which costs O(m) instead of O(D) per
+* kernel evaluation. With LowRankIVM the log-det itself is computed in the m x m
+* feature space.
+* Note, that the solutions of the optimizers then hold projected rows. Use the ids
+* to get back to the original rows.
+*/
+
+/**
+ * @brief  Interface of an explicit (approximate) kernel feature map.
+ */
+class FeatureMap {
+public:
+    // Number of output features m
+    virtual size_t dimension() const = 0;
+
+    /**
+     * @brief  Computes z(x).
+     * @param  x: Pointer to the D input features.
+     * @param  z: Is overwritten with the m output features.
+     */
+    virtual void transform(data_t const* x, vector<data_t>& z) const = 0;
+
+    inline vector<data_t> transform(vector<data_t> const& x) const {
+        vector<data_t> z;
+        transform(x.data(), z);
+        return z;
+    }
+
+    // Projects every row of X
+    Dataset transform(DatasetView const& X) const {
+        Dataset Z(X.size(), dimension());
+        vector<data_t> z;
+        for (size_t i = 0; i < X.size(); ++i) {
+            transform(X.row(i), z);
+            copy(z.begin(), z.end(), Z.row(i));
+        }
+        return Z;
+    }
+
+    vector<vector<data_t>> transform(vector<vector<data_t>> const& X) const {
+        vector<vector<data_t>> Z(X.size());
+        for (size_t i = 0; i < X.size(); ++i) {
+            transform(X[i].data(), Z[i]);
+        }
+        return Z;
+    }
+
+    virtual ~FeatureMap() {}
+};
+
+/**
+ * @brief  Random Fourier features (Rahimi & Recht, 2007) for RBFKernel(sigma, scale),
+        that is k(x, y) = scale * exp(-||x - y||^2 / sigma):
+ *
+ *      z(x)_i = sqrt(2 scale / m) * cos(<w_i, x> + b_i),   w_i ~ N(0, 2 / sigma * I), b_i ~ U[0, 2 pi]
+ *
+ *  The approximation error of a kernel value is O(1 / sqrt(m)). Projecting a row costs
+ *  O(m * D).
+ */
+class RandomFourierFeatures : public FeatureMap {
+private:
+    size_t D;
+    size_t m;
+    data_t norm;
+    // m x D row-major
+    vector<data_t> W;
+    vector<data_t> b;
+
+public:
+    /**
+     * @brief  Samples a new feature map.
+     * @param  D: Number of input features.
+     * @param  m: Number of random features.
+     * @param  sigma: The sigma of the approximated RBFKernel.
+     * @param  scale: The scale of the approximated RBFKernel.
+     * @param  seed: The random seed.
+     */
+    RandomFourierFeatures(size_t D, size_t m, data_t sigma, data_t scale = 1.0, unsigned long seed = 0)
+        : D(D), m(m), norm(sqrt(2.0 * scale / m)), W(m * D), b(m) {
+        if (m == 0 || sigma <= 0) {
+            throw runtime_error("RandomFourierFeatures: m and sigma must be positive.");
+        }
+        default_random_engine gen(seed);
+        normal_distribution<double> normal(0.0, sqrt(2.0 / sigma));
+        uniform_real_distribution<double> uniform(0.0, 2.0 * 3.14159265358979323846);
+        for (auto& w : W) w = static_cast<data_t>(normal(gen));
+        for (auto& bi : b) bi = static_cast<data_t>(uniform(gen));
+    }
+
+    using FeatureMap::transform;
+
+    size_t dimension() const override { return m; }
+
+    void transform(data_t const* x, vector<data_t>& z) const override {
+        z.resize(m);
+        for (size_t i = 0; i < m; ++i) {
+            data_t const* w = &W[i * D];
+            accum_t s = inner_product(x, x + D, w, static_cast<accum_t>(b[i]));
+            z[i] = norm * cos(s);
+        }
+    }
+};
+
+/**
+ * @brief  The Nystroem feature map (Williams & Seeger, 2001) of an arbitrary kernel
+        built from m landmark rows l_1, ..., l_m:
+ *
+ *      z(x) = L^-1 (k(l_1, x), ..., k(l_m, x)),   K_LL + lambda I = L L^T
+ *
+ *  so that <z(x), z(y)> = k_L(x)^T (K_LL + lambda I)^-1 k_L(y). It is exact for the
+ *  landmarks themselves and usually needs far fewer features than random Fourier
+ *  features for the same accuracy. Projecting a row costs m kernel evaluations plus
+ *  an O(m^2) forward substitution.
+ */
+class NystroemFeatures : public FeatureMap {
+private:
+    shared_ptr<Kernel> kernel;
+    vector<vector<data_t>> landmarks;
+    Matrix L;
+
+public:
+    /**
+     * @brief  Builds the feature map.
+     * @param  kernel: The kernel to be approximated.
+     * @param  landmarks: The landmark rows, e.g. sampled with sample_landmarks().
+     * @param  lambda: A small ridge which keeps K_LL positive definite, e.g. if two
+            landmarks are (almost) identical.
+     */
+    NystroemFeatures(Kernel const& kernel, vector<vector<data_t>> const& landmarks, data_t lambda = 1e-6)
+        : kernel(kernel.clone()), landmarks(landmarks), L(landmarks.size()) {
+        if (landmarks.empty()) {
+            throw runtime_error("NystroemFeatures: At least one landmark is required.");
+        }
+        size_t m = landmarks.size();
+        Matrix K_LL(m);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j <= i; ++j) {
+                K_LL(i, j) = K_LL(j, i) = kernel(landmarks[i], landmarks[j]) + (i == j ? lambda : 0);
+            }
+        }
+        L = cholesky(K_LL);
+    }
+
+    using FeatureMap::transform;
+
+    size_t dimension() const override { return landmarks.size(); }
+
+    void transform(data_t const* x, vector<data_t>& z) const override {
+        size_t m = landmarks.size();
+        vector<data_t> row(x, x + landmarks[0].size());
+        z.resize(m);
+        for (size_t i = 0; i < m; ++i) {
+            accum_t s = (*kernel)(landmarks[i], row);
+            for (size_t j = 0; j < i; ++j) {
+                s -= L(i, j) * z[j];
+            }
+            z[i] = s / L(i, i);
+        }
+    }
+};
+
+/**
+ * @brief  Samples m distinct rows of X as Nystroem landmarks.
+ */
+inline vector<vector<data_t>> sample_landmarks(DatasetView const& X, size_t m, unsigned long seed = 0) {
+    vector<size_t> idx(X.size());
+    iota(idx.begin(), idx.end(), 0);
+    default_random_engine gen(seed);
+    shuffle(idx.begin(), idx.end(), gen);
+    idx.resize(min(m, idx.size()));
+
+    vector<vector<data_t>> landmarks;
+    for (auto i : idx) {
+        landmarks.emplace_back(X.row(i), X.row(i) + X.dimension());
+    }
+    return landmarks;
+}
+
+/**
+ * @brief  The linear kernel k(x, y) = scale * <x, y>, which turns projected rows back
+        into (approximate) kernel values.
+ */
+class DotProductKernel : public Kernel {
+private:
+    data_t scale;
+
+public:
+    DotProductKernel(data_t scale = 1.0) : scale(scale) {}
+
+    inline data_t operator()(const vector<data_t>& x1, const vector<data_t>& x2) const override {
+        MetricTimer timer(MetricEvent::kernel);
+        return scale * inner_product(x1.begin(), x1.end(), x2.begin(), static_cast<accum_t>(0));
+    }
+
+    shared_ptr<Kernel> clone() const override {
+        return shared_ptr<Kernel>(new DotProductKernel(scale));
+    }
+};
+
+/**
+ * @brief  A DataSource which projects every element of another DataSource with a
+        FeatureMap as it is read, so the optimizers never see the original rows.
+ */
+class ProjectedDataSource : public DataSource {
+private:
+    unique_ptr<DataSource> source;
+    shared_ptr<FeatureMap const> map;
+    vector<data_t> x;
+
+public:
+    ProjectedDataSource(unique_ptr<DataSource> source, shared_ptr<FeatureMap const> map)
+        : source(move(source)), map(map) {}
+
+    bool next(vector<data_t>& z, idx_t& id) override {
+        if (!source->next(x, id)) {
+            return false;
+        }
+        map->transform(x.data(), z);
+        return true;
+    }
+};
+
+#endif // KERNEL_APPROXIMATION_H
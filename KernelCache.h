@@ -0,0 +1,145 @@
+#ifndef KERNEL_CACHE_H
+#define KERNEL_CACHE_H
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <unordered_map>
+
+#include "DataTypeHandling.h"
+
+using namespace std;
+
+/**
+ * @brief  Shares kernel values between many optimizers which consume the same stream,
+        see FanOut. Every stream element is identified by a tag (its position in the
+        stream), and functions such as FastIVM remember the tag of every element of
+        their solution. Different optimizers (e.g. sieves with neighboring thresholds
+        or the same sieve for different epsilon) often hold the same elements, so the
+        kernel value k(s, x) of a stored element s and the current element x is only
+        computed by the first function which asks for it. All others read it from
+        the cache, which returns exactly the same value.
+
+        The cache holds one slot per element of the current batch. The tag of the
+        element which the calling thread currently processes is set by a Scope.
+        Functions which are used outside of a Scope (or with elements from before
+        the current batch) simply evaluate the kernel.
+ * @note   A cache must only be shared by functions which use the same kernel.
+ */
+class KernelCache {
+public:
+    // The tag of elements which were not seen through a FanOut
+    static constexpr uint64_t NO_TAG = numeric_limits<uint64_t>::max();
+
+private:
+    struct Slot {
+        mutex lock;
+        unordered_map<uint64_t, data_t> values;
+    };
+
+    size_t capacity;
+    // Only lock the slots if several threads use the cache
+    bool concurrent;
+    unique_ptr<Slot[]> slots;
+    // The tag of the element in slots[0]
+    uint64_t first = 0;
+
+    atomic<size_t> hits;
+    atomic<size_t> misses;
+
+    static inline uint64_t& current_tag() {
+        static thread_local uint64_t tag = NO_TAG;
+        return tag;
+    }
+
+public:
+    /**
+     * @brief  Sets the tag of the element the calling thread processes until the scope ends.
+     */
+    class Scope {
+    private:
+        uint64_t previous;
+
+    public:
+        explicit Scope(uint64_t tag) : previous(current_tag()) {
+            current_tag() = tag;
+        }
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+        ~Scope() {
+            current_tag() = previous;
+        }
+    };
+
+    /**
+     * @brief  Creates a new cache.
+     * @param  capacity: The number of elements which are cached at the same time,
+            i.e. the batch size of the FanOut.
+     * @param  concurrent: true if several threads call get() at the same time.
+     */
+    explicit KernelCache(size_t capacity, bool concurrent = true)
+        : capacity(capacity), concurrent(concurrent), slots(new Slot[capacity]), hits(0), misses(0) {}
+
+    // The tag of the element the calling thread currently processes or NO_TAG
+    static inline uint64_t current() {
+        return current_tag();
+    }
+
+    /**
+     * @brief  Forgets all cached values and starts a new batch. Must not be called while
+            other threads use the cache.
+     * @param  first_tag: The tag of the first element of the new batch.
+     */
+    void reset(uint64_t first_tag) {
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].values.clear();
+        }
+        first = first_tag;
+    }
+
+    /**
+     * @brief  The kernel value of the stored element with the given tag and the current
+            element, computed by `compute' if it is not cached yet.
+     * @param  stored: The tag of the stored element.
+     * @param  compute: Evaluates the kernel, e.g. a lambda calling Kernel::operator().
+     * @retval The kernel value.
+     */
+    template <typename Compute>
+    data_t get(uint64_t stored, Compute compute) {
+        uint64_t cur = current_tag();
+        if (cur == NO_TAG || stored == NO_TAG || cur - first >= capacity) {
+            return compute();
+        }
+
+        Slot& slot = slots[cur - first];
+        unique_lock<mutex> guard(slot.lock, defer_lock);
+        if (concurrent) guard.lock();
+        auto it = slot.values.find(stored);
+        if (it != slot.values.end()) {
+            hits.fetch_add(1, memory_order_relaxed);
+            return it->second;
+        }
+        if (concurrent) guard.unlock();
+
+        // Evaluated without holding the lock, two threads may compute the same value
+        data_t value = compute();
+        misses.fetch_add(1, memory_order_relaxed);
+        if (concurrent) guard.lock();
+        slot.values.emplace(stored, value);
+        return value;
+    }
+
+    inline size_t get_hits() const { return hits.load(memory_order_relaxed); }
+
+    inline size_t get_misses() const { return misses.load(memory_order_relaxed); }
+
+    inline size_t get_capacity() const { return capacity; }
+
+    inline bool is_concurrent() const { return concurrent; }
+};
+
+#endif // KERNEL_CACHE_H
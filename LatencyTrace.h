@@ -0,0 +1,226 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cmath>
+
+#include "DataTypeHandling.h"
+
+using namespace std;
+
+/**
+ * @brief  One call of next() of a streaming optimizer.
+ */
+struct TraceEvent {
+    // Start of the call, in nanoseconds since the trace was created
+    uint64_t start_ns;
+    // Duration of the call in nanoseconds
+    uint64_t duration_ns;
+    // Number of sieves which queried the function for this element
+    uint32_t sieves_touched;
+    // Number of sieves created / deleted during this call
+    uint32_t sieves_created;
+    uint32_t sieves_deleted;
+};
+
+/**
+ * @brief  A histogram of durations with log-linear buckets in the spirit of
+        HdrHistogram: every power of two is divided into 2^SUB_BUCKET_BITS linear
+        sub-buckets, so every recorded value is known up to a relative error of
+        2^-SUB_BUCKET_BITS (< 1%) while the memory stays constant.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned int SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    // Values up to 2^MAX_BITS ns (~ 9 minutes) are resolved, larger ones are clamped
+    static constexpr unsigned int MAX_BITS = 40;
+
+private:
+    vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    static inline size_t index_of(uint64_t v) {
+        if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+        unsigned int msb = 0;
+        while ((v >> (msb + 1)) != 0) ++msb;
+        unsigned int shift = msb - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((v >> shift) - SUB_BUCKETS));
+    }
+
+    // The largest value which falls into bucket i
+    static inline uint64_t upper_edge(size_t i) {
+        if (i < SUB_BUCKETS) return i;
+        unsigned int shift = static_cast<unsigned int>(i / SUB_BUCKETS) - 1;
+        uint64_t base = (SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+        return base + (uint64_t(1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() : counts((MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS, 0) {}
+
+    inline void record(uint64_t v) {
+        v = min(v, (uint64_t(1) << MAX_BITS) - 1);
+        ++counts[index_of(v)];
+        ++total;
+        max_value = max(max_value, v);
+    }
+
+    inline uint64_t count() const { return total; }
+    inline uint64_t max_recorded() const { return max_value; }
+
+    /**
+     * @brief  Returns the p-th percentile (0 <= p <= 100), that is the smallest
+            bucket edge such that at least p percent of the values are not larger.
+     */
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(ceil(p / 100.0 * total));
+        rank = max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) return min(upper_edge(i), max_value);
+        }
+        return max_value;
+    }
+
+    /**
+     * @brief  Writes the percentile distribution in the text format of
+            HdrHistogram's outputPercentileDistribution (values in microseconds), which
+            can be plotted e.g. with the HdrHistogram plotter.
+     * @param  out: The output stream.
+     * @param  ticks_per_half_distance: Number of reported percentiles per halving of
+            the distance to 100%.
+     */
+    void write_percentiles(ostream& out, unsigned int ticks_per_half_distance = 5) const {
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+        auto line = [&](double p) {
+            uint64_t v = percentile(p);
+            uint64_t below = 0;
+            for (size_t i = 0; i < counts.size() && min(upper_edge(i), max_value) <= v; ++i) below += counts[i];
+            out.precision(3);
+            out << fixed;
+            out.width(12); out << v / 1000.0 << " ";
+            out.precision(12);
+            out.width(14); out << p / 100.0 << " ";
+            out.width(10); out << below << " ";
+            out.precision(2);
+            if (p < 100.0) {
+                out.width(14); out << 1.0 / (1.0 - p / 100.0);
+            }
+            out << "\n";
+        };
+
+        if (total > 0) {
+            for (unsigned int half = 0; half < 20; ++half) {
+                double remaining = 100.0 / (1 << half);
+                for (unsigned int t = 0; t < ticks_per_half_distance; ++t) {
+                    line(100.0 - remaining + remaining / 2 * t / ticks_per_half_distance);
+                }
+                if (percentile(100.0 - remaining / 2) >= max_value) break;
+            }
+            line(100.0);
+        }
+        out.flags(flags);
+        out.precision(precision);
+        out << "#[Max = " << max_value / 1000.0 << ", Total count = " << total << "]" << endl;
+    }
+};
+
+/**
+ * @brief  Records the most recent `capacity' TraceEvents of a streaming optimizer in a
+        fixed-size ring buffer. Older events are overwritten, but every event is also
+        added to a LatencyHistogram, so the latency distribution always covers the
+        entire stream. Recording never allocates.
+ */
+class LatencyTrace {
+private:
+    vector<TraceEvent> ring;
+    // Total number of recorded events
+    uint64_t recorded = 0;
+    LatencyHistogram hist;
+    chrono::steady_clock::time_point origin;
+
+public:
+    LatencyTrace(size_t capacity) : ring(capacity), origin(chrono::steady_clock::now()) {
+        if (capacity == 0) {
+            throw runtime_error("LatencyTrace: The capacity must be positive.");
+        }
+    }
+
+    // Nanoseconds since this trace was created
+    inline uint64_t now() const {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count());
+    }
+
+    inline void record(TraceEvent const& e) {
+        ring[recorded % ring.size()] = e;
+        ++recorded;
+        hist.record(e.duration_ns);
+    }
+
+    inline size_t capacity() const { return ring.size(); }
+
+    // Total number of recorded events, including the ones which were overwritten
+    inline uint64_t num_recorded() const { return recorded; }
+
+    // The latency distribution of all recorded events
+    inline LatencyHistogram const& histogram() const { return hist; }
+
+    // The events still held in the ring buffer, oldest first
+    vector<TraceEvent> events() const {
+        vector<TraceEvent> out;
+        size_t n = static_cast<size_t>(min<uint64_t>(recorded, ring.size()));
+        out.reserve(n);
+        for (uint64_t i = recorded - n; i < recorded; ++i) {
+            out.push_back(ring[i % ring.size()]);
+        }
+        return out;
+    }
+
+    /**
+     * @brief  Writes the buffered events in the Chrome trace event format, which can be
+            loaded into chrome://tracing or https://ui.perfetto.dev. Every next() call
+            becomes a complete ("X") event, the sieve counters are attached as args and
+            are also emitted as a counter ("C") track.
+     * @param  out: The output stream.
+     * @param  name: The name of the traced optimizer.
+     */
+    void write_chrome_trace(ostream& out, string const& name = "next") const {
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out.precision(3);
+        out << fixed << "{\"traceEvents\": [";
+        bool first = true;
+        for (auto const& e : events()) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\": \"" << name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0"
+                << ", \"ts\": " << e.start_ns / 1000.0 << ", \"dur\": " << e.duration_ns / 1000.0
+                << ", \"args\": {\"sieves_touched\": " << e.sieves_touched
+                << ", \"sieves_created\": " << e.sieves_created
+                << ", \"sieves_deleted\": " << e.sieves_deleted << "}}";
+            if (e.sieves_created > 0 || e.sieves_deleted > 0) {
+                out << ",\n{\"name\": \"sieves\", \"ph\": \"C\", \"pid\": 0, \"tid\": 0"
+                    << ", \"ts\": " << e.start_ns / 1000.0
+                    << ", \"args\": {\"created\": " << e.sieves_created
+                    << ", \"deleted\": " << e.sieves_deleted << "}}";
+            }
+        }
+        out << "\n], \"displayTimeUnit\": \"ns\"}" << endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+#endif // LATENCY_TRACE_H
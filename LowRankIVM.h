@@ -0,0 +1,161 @@
+#ifndef LOW_RANK_IVM_H
+#define LOW_RANK_IVM_H
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+#include "DataTypeHandling.h"
+#include "SubmodularFunction.h"
+#include "Matrix.h"
+
+using namespace std;
+
+/**
+ * @brief  The IVM / log-det objective f(S) = log det(I + K_S / sigma^2) for a kernel which
+        is given by an explicit m-dimensional feature map, K_S = Z Z^T, e.g. rows which
+        were projected with RandomFourierFeatures or NystroemFeatures. By Sylvester's
+        determinant identity
+ *
+ *      log det(I_K + Z Z^T / sigma^2) = log det(I_m + Z^T Z / sigma^2) = log det(A),
+ *
+ *  so instead of a K x K Cholesky factor this function keeps A^-1 (m x m). The gain of
+ *  adding z is log(1 + z^T A^-1 z / sigma^2) and A^-1 is updated with Sherman-Morrison,
+ *  thus peek and update cost O(m^2) independent of K and of the original dimension D.
+ *  It gives the same values as FastIVM with DotProductKernel on the projected rows.
+ *  Worth it if m is small compared to K, otherwise use FastIVM with DotProductKernel.
+ *  Every clone (i.e. every sieve) allocates m x m values.
+ */
+class LowRankIVM : public SubmodularFunction {
+protected:
+    unsigned int m;
+    data_t sigma;
+    // A^-1 = (I + Z^T Z / sigma^2)^-1
+    Matrix Ainv;
+    accum_t fval;
+    // Scratch space for A^-1 z
+    vector<accum_t> v, w;
+
+    inline accum_t sigma2() const { return static_cast<accum_t>(sigma) * sigma; }
+
+    // v = A^-1 z, returns z^T A^-1 z
+    inline accum_t quad(vector<data_t> const& z, vector<accum_t>& out) const {
+        if (z.size() != m) {
+            throw runtime_error("LowRankIVM: Expected " + to_string(m) + " features, but got " + to_string(z.size()) + ".");
+        }
+        accum_t q = 0;
+        for (unsigned int i = 0; i < m; ++i) {
+            accum_t s = 0;
+            for (unsigned int j = 0; j < m; ++j) {
+                s += Ainv(i, j) * z[j];
+            }
+            out[i] = s;
+            q += s * z[i];
+        }
+        return q;
+    }
+
+    // A^-1 <- A^-1 - sign * v v^T / (sigma^2 + sign * z^T A^-1 z), i.e. A <- A + sign * z z^T / sigma^2
+    inline void rank_one(vector<accum_t> const& v, accum_t q, accum_t sign) {
+        accum_t c = sign / (sigma2() + sign * q);
+        for (unsigned int i = 0; i < m; ++i) {
+            for (unsigned int j = 0; j < m; ++j) {
+                Ainv(i, j) -= c * v[i] * v[j];
+            }
+        }
+    }
+
+    void reset() {
+        for (unsigned int i = 0; i < m; ++i) {
+            for (unsigned int j = 0; j < m; ++j) {
+                Ainv(i, j) = i == j ? 1.0 : 0.0;
+            }
+        }
+        fval = 0;
+    }
+
+public:
+    /**
+     * @brief  Creates a new function.
+     * @param  m: Number of features of every element.
+     * @param  sigma: The sigma of the objective, see FastIVM.
+     */
+    LowRankIVM(unsigned int m, data_t sigma) : m(m), sigma(sigma), Ainv(m), fval(0), v(m), w(m) {
+        reset();
+    }
+
+    data_t peek(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        accum_t qx = quad(x, v);
+        if (pos >= cur_solution.size()) {
+            return fval + log(1.0 + qx / sigma2());
+        }
+
+        // Remove y = cur_solution[pos] first, then add x
+        vector<data_t> const& y = cur_solution[pos];
+        accum_t qy = quad(y, w);
+        accum_t xy = inner_product(x.begin(), x.end(), w.begin(), static_cast<accum_t>(0));
+        accum_t qx_without_y = qx + xy * xy / (sigma2() - qy);
+        return fval + log(1.0 - qy / sigma2()) + log(1.0 + qx_without_y / sigma2());
+    }
+
+    void update(vector<vector<data_t>> const& cur_solution, vector<data_t> const& x, unsigned int pos) override {
+        if (pos < cur_solution.size()) {
+            accum_t qy = quad(cur_solution[pos], w);
+            fval += log(1.0 - qy / sigma2());
+            rank_one(w, qy, -1.0);
+        }
+        accum_t qx = quad(x, v);
+        fval += log(1.0 + qx / sigma2());
+        rank_one(v, qx, 1.0);
+    }
+
+    data_t operator()(vector<vector<data_t>> const& cur_solution) const override {
+        Matrix A(m);
+        for (unsigned int i = 0; i < m; ++i) {
+            A(i, i) = 1.0;
+        }
+        for (auto const& z : cur_solution) {
+            for (unsigned int i = 0; i < m; ++i) {
+                for (unsigned int j = 0; j < m; ++j) {
+                    A(i, j) += static_cast<accum_t>(z[i]) * z[j] / sigma2();
+                }
+            }
+        }
+        return log_det(A);
+    }
+
+    // The state does not grow with the solution, so it is always written in full
+    void save(BinaryWriter& out, unsigned int from = 0) const override {
+        out.write<uint32_t>(m);
+        out.write<accum_t>(fval);
+        for (unsigned int i = 0; i < m; ++i) {
+            for (unsigned int j = 0; j < m; ++j) {
+                out.write<accum_t>(Ainv(i, j));
+            }
+        }
+    }
+
+    void load(BinaryReader& in, unsigned int from = 0) override {
+        if (in.read<uint32_t>() != m) {
+            throw runtime_error("LowRankIVM::load: The checkpoint was written for a different number of features.");
+        }
+        fval = in.read<accum_t>();
+        for (unsigned int i = 0; i < m; ++i) {
+            for (unsigned int j = 0; j < m; ++j) {
+                Ainv(i, j) = in.read<accum_t>();
+            }
+        }
+    }
+
+    size_t get_memory_bytes() const override {
+        return sizeof(LowRankIVM) + Ainv.get_memory_bytes() + (v.capacity() + w.capacity()) * sizeof(accum_t);
+    }
+
+    shared_ptr<SubmodularFunction> clone() const override {
+        return make_shared<LowRankIVM>(m, sigma);
+    }
+};
+
+#endif // LOW_RANK_IVM_H
@@ -4,24 +4,26 @@
 #include <vector>
 #include <string> 
 #include <cmath>  
+#include <algorithm>
 
 #include "DataTypeHandling.h"
+#include "Metrics.h"
 
 using namespace std;
 
-class Matrix {//ǶԳ
+class Matrix {//这里是对称正定矩阵
 private:
-    unsigned int N;///еĴС
-    // ʹstd::vectorԭָҪԭ
-    // 1std::vectorִC++ԭָе㱻
-    // 2ԭָʹʵֺʵĸ/ƶ캯ʮ
-    vector<data_t> data;//һά洢
+    unsigned int N;//行/列的大小
+    // 使用std::vector替代原生指针主要有以下两个原因
+    // （1）std::vector更具现代C++风格，原生指针有点被遗弃
+    // （2）原生指针使得实现合适的复制/移动构造函数十分困难
+    vector<accum_t> data;//一维向量存储矩阵
 
 public:
 
     /*
-    * 캯1ƾotherϽN_sub*N_subӾ¾
-    * 豣֤N_sub<=other.size()
+    * 构造函数1，复制矩阵other的左上角N_sub*N_sub的子矩阵至新矩阵。
+    * 需保证N_sub<=other.size()。
     */
     Matrix(Matrix const& other, unsigned int N_sub) : N(N_sub), data(N_sub* N_sub) {
         for (unsigned int i = 0; i < N_sub; ++i) {
@@ -31,37 +33,40 @@ public:
         }
     }
     /*
-    * 캯2ĬΪ_size_sizeе
+    * 构造函数2，默认为_size行_size列的零矩阵
     */
     Matrix(unsigned int _size) : N(_size), data(_size* _size, 0) {}
 
     ~Matrix() { }
 
     /*
-    * /еĴС
+    * 返回行/列的大小
     */
     inline unsigned int size() const { return N; }
 
+    // The memory of the entries in bytes
+    inline size_t get_memory_bytes() const { return data.capacity() * sizeof(accum_t); }
+
     /*
-    * *x滻ԭrowеݡ
-    * ʵȴ滻˵rowеݡ
-    * xָΪdata_tĳĳָ롣
+    * 函数命名来看是用*x替换矩阵原第row行的内容。
+    * 但实际上却是替换了第row列的内容。
+    * x是指向类型为accum_t的常变量的常指针。
     */
-    void replace_row(unsigned int row, data_t const* const x) {
+    void replace_row(unsigned int row, accum_t const* const x) {
         for (unsigned int i = 0; i < N; ++i) {
             this->operator()(i, row) = x[i];
         }
     }
      
-    void replace_column(unsigned int col, data_t const* const x) {
+    void replace_column(unsigned int col, accum_t const* const x) {
         for (unsigned int i = 0; i < N; ++i) {
             this->operator()(col, i) = x[i];
         }
     }
     /*
-    * һУ
+    * 秩一校正。
     */
-    void rank_one_update(unsigned int row, data_t const* const x) {
+    void rank_one_update(unsigned int row, accum_t const* const x) {
         for (unsigned int i = 0; i < N; ++i) {
             if (row == i) {
                 this->operator()(i, i) += x[i];
@@ -73,21 +78,69 @@ public:
         }
     }
     /*
-    * []
+    * 重载运算符[]
     */
-    data_t& operator [](int i) { return  data[i * N]; }
-    data_t operator [](int i) const { return data[i * N]; }
+    accum_t& operator [](int i) { return  data[i * N]; }
+    accum_t operator [](int i) const { return data[i * N]; }
 
     /*
-    * ()
+    * 重载运算符()
     */
-    data_t& operator()(int i, int j) { return data[i * N + j]; }
-    data_t operator()(int i, int j) const { return data[i * N + j]; }
+    accum_t& operator()(int i, int j) { return data[i * N + j]; }
+    accum_t operator()(int i, int j) const { return data[i * N + j]; }
 };
 
 /*
-* غto_string
-* ַʽmatϽN_sub*N_subСӾ
+* A lower triangular matrix, e.g. a Cholesky factor or the lower triangle of a symmetric
+* matrix. The rows are packed one after another: row i holds the i + 1 entries
+* (i, 0), ..., (i, i) and starts at i * (i + 1) / 2. Thus every row is contiguous, and
+* a matrix which grows by one row at a time does not move the existing entries into a
+* new layout. Its storage tracks the number of rows instead of being allocated for the
+* largest size up-front, and the capacity at least doubles whenever it is exceeded, so
+* growing row by row costs amortized O(1) per entry.
+* Only the entries (i, j) with j <= i may be accessed.
+*/
+class TriangularMatrix {
+private:
+    unsigned int N;
+    vector<accum_t> data;
+
+    static inline size_t offset(unsigned int i) { return static_cast<size_t>(i) * (i + 1) / 2; }
+
+public:
+    explicit TriangularMatrix(unsigned int N = 0) : N(N), data(offset(N), 0) {}
+
+    // Copies the upper left N_sub x N_sub block of other, N_sub <= other.size()
+    TriangularMatrix(TriangularMatrix const& other, unsigned int N_sub)
+        : N(N_sub), data(other.data.begin(), other.data.begin() + offset(N_sub)) {}
+
+    TriangularMatrix(TriangularMatrix const& other) = default;
+    TriangularMatrix(TriangularMatrix&& other) = default;
+    TriangularMatrix& operator=(TriangularMatrix const& other) = default;
+    TriangularMatrix& operator=(TriangularMatrix&& other) = default;
+
+    inline unsigned int size() const { return N; }
+
+    // Changes the number of rows, new entries are zero. Shrinking keeps the capacity
+    void resize(unsigned int N_new) {
+        size_t needed = offset(N_new);
+        if (needed > data.capacity()) {
+            data.reserve(max(needed, 2 * data.capacity()));
+        }
+        data.resize(needed, 0);
+        N = N_new;
+    }
+
+    // The memory of the entries in bytes
+    inline size_t get_memory_bytes() const { return data.capacity() * sizeof(accum_t); }
+
+    accum_t& operator()(int i, int j) { return data[offset(i) + j]; }
+    accum_t operator()(int i, int j) const { return data[offset(i) + j]; }
+};
+
+/*
+* 重载函数to_string。
+* 字符式返回mat的左上角N_sub*N_sub大小的子矩阵。
 */
 inline string to_string(Matrix const& mat, unsigned int N_sub) {
     string s = "[";
@@ -114,34 +167,42 @@ inline string to_string(Matrix const& mat, unsigned int N_sub) {
     return s + "]";
 }
 /*
-* غto_string
-* ַʽؾmat
+* 重载函数to_string。
+* 字符式返回矩阵mat。
 */
 inline string to_string(Matrix const& mat) {
     return to_string(mat, mat.size());
 }
 
 /*
-* choleskyֽ⣺A = L*L^T
-* ﷵصLӦǾԪضΪ0
-* ʵϺļֻҪõԽߵԪʽ
-* LʵϵԪزΪ0ԭֵ
-*ԪδдֻԪؼԽԪأ
+* Computes the lower triangle (including the diagonal) of the cholesky factor of the
+* upper left N_sub x N_sub block of in into the existing matrix L, which must have at
+* least N_sub rows. The upper triangle of L is not touched. This allows to re-use L
+* as a scratch matrix between calls.
+* If min_pivot > 0, every pivot in(j, j) - sum which is not larger than min_pivot
+* (including NaN pivots) is clamped to min_pivot, so that L stays finite and invertible
+* for (numerically) singular or indefinite matrices.
+* Only lower triangles are accessed, so in and L may be Matrix or TriangularMatrix.
 */
-inline Matrix cholesky(Matrix const& in, unsigned int N_sub) {
-    Matrix L(in, N_sub);
+template <typename InMatrix, typename OutMatrix>
+inline void cholesky(InMatrix const& in, unsigned int N_sub, OutMatrix& L, accum_t min_pivot = 0) {
+    MetricTimer timer(MetricEvent::cholesky);
 
     for (unsigned int j = 0; j < N_sub; ++j) {
-        data_t sum = 0.0;
+        accum_t sum = 0.0;
 
         for (unsigned int k = 0; k < j; ++k) {
             sum += L(j, k) * L(j, k);
         }
 
-        L(j, j) = sqrt(in(j, j) - sum);
+        accum_t pivot = in(j, j) - sum;
+        if (min_pivot > 0 && !(pivot > min_pivot)) {
+            pivot = min_pivot;
+        }
+        L(j, j) = sqrt(pivot);
         
         for (unsigned int i = j + 1; i < N_sub; ++i) {
-            data_t sum = 0.0;
+            accum_t sum = 0.0;
 
             for (unsigned int k = 0; k < j; ++k) {
                 sum += L(i, k) * L(j, k);
@@ -150,35 +211,52 @@ inline Matrix cholesky(Matrix const& in, unsigned int N_sub) {
             
         }
     }
+}
+
+/*
+* cholesky分解：A = L*L^T。
+* 这里返回的L理论上应该是下三角矩阵，上三角元素都为0，
+* 但是实际上后面的计算只需要用到对角线的元素来求行列式，
+* 所以这里的L实际上的上三角元素并不会为0，而是原来的值
+*（即上三角元素未进行处理，只处理了下三角元素及对角元素）
+*/
+inline Matrix cholesky(Matrix const& in, unsigned int N_sub) {
+    Matrix L(in, N_sub);
+    cholesky(in, N_sub, L);
     return L;
 }
 
 inline Matrix cholesky(Matrix const& in) { return cholesky(in, in.size()); }
 
 /*
-* A=L*L^T˻ʽھʽĳ˻
-*  |A|=|L|*|L^T|LǾ󣬼 |L| = L(0,0)*L(1,1)*...*L(n-1,n-1)
-* ָݶlog(|L|) = log(L(0,0))+...+log(L(n-1,n-1))
-* LL^TĶԽԪͬôlog(|A|)=2*log(|L|)
+* A=L*L^T，矩阵乘积的行列式等于矩阵行列式的乘积。
+* 故 |A|=|L|*|L^T|。由于L理论上是下三角矩阵，即 |L| = L(0,0)*L(1,1)*...*L(n-1,n-1)。
+* 又根据对数运算规则，有log(|L|) = log(L(0,0))+...+log(L(n-1,n-1))。
+* 又L和L^T的对角线元素相同，那么log(|A|)=2*log(|L|)
 */
-inline data_t log_det_from_cholesky(Matrix const& L) {
-    data_t det = 0;
+template <typename LMatrix>
+inline accum_t log_det_from_cholesky(LMatrix const& L, unsigned int N_sub) {
+    accum_t det = 0;
 
-    for (size_t i = 0; i < L.size(); ++i) {
+    for (size_t i = 0; i < N_sub; ++i) {
         det += log(L(i, i));
     }
 
     return 2 * det;
 }
+
+inline accum_t log_det_from_cholesky(Matrix const& L) {
+    return log_det_from_cholesky(L, L.size());
+}
 /*
-* matϽN_sub*N_subСӾĶʽ
+* 计算矩阵mat左上角N_sub*N_sub大小的子矩阵的对数行列式
 */
-inline data_t log_det(Matrix const& mat, unsigned int N_sub) {
+inline accum_t log_det(Matrix const& mat, unsigned int N_sub) {
     Matrix L = cholesky(mat, N_sub);
     return log_det_from_cholesky(L);
 }
 
-inline data_t log_det(Matrix const& mat) {
+inline accum_t log_det(Matrix const& mat) {
     return log_det(mat, mat.size());
 }
 
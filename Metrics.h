@@ -0,0 +1,254 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+using namespace std;
+
+/*
+* Instrumentation counters. Everything in this file is compiled out unless
+* SUBMODULAR_METRICS is defined: MetricTimer and MetricsScope become empty objects
+* and OptimizerMetrics always reports zero, so the hooks in the optimizers,
+* functions and kernels cost nothing in a regular build.
+*/
+
+// The instrumented operations
+enum class MetricEvent {
+    peek,           // SubmodularFunction::peek
+    update,         // SubmodularFunction::update
+    evaluate,       // SubmodularFunction::operator()
+    kernel,         // Kernel::operator()
+    cholesky,       // a full (re-)computation of a Cholesky decomposition
+    sieve_next,     // one pass of an element over all sieves
+    solution_copy   // the best sieve's solution is copied into the optimizer
+};
+
+static constexpr size_t NUM_METRIC_EVENTS = 7;
+
+inline char const* to_string(MetricEvent e) {
+    static char const* names[NUM_METRIC_EVENTS] = {
+        "peek", "update", "evaluate", "kernel", "cholesky", "sieve_next", "solution_copy"
+    };
+    return names[static_cast<size_t>(e)];
+}
+
+#ifdef SUBMODULAR_METRICS
+
+/**
+ * @brief  A histogram of durations with power-of-two buckets: bucket b counts the
+        durations in [2^b, 2^(b+1)) nanoseconds.
+ */
+class TimeHistogram {
+public:
+    static constexpr size_t NUM_BUCKETS = 48;
+
+private:
+    array<uint64_t, NUM_BUCKETS> buckets{};
+    uint64_t samples = 0;
+    uint64_t total_ns = 0;
+
+public:
+    inline void record(uint64_t ns) {
+        size_t b = 0;
+        while (b + 1 < NUM_BUCKETS && (ns >> (b + 1)) != 0) ++b;
+        ++buckets[b];
+        ++samples;
+        total_ns += ns;
+    }
+
+    inline uint64_t bucket(size_t b) const { return buckets[b]; }
+    inline uint64_t num_samples() const { return samples; }
+    inline uint64_t total_nanoseconds() const { return total_ns; }
+
+    /**
+     * @brief  Returns an upper bound of the p-th percentile (0 <= p <= 100), namely
+            the upper edge of the bucket which contains it.
+     */
+    uint64_t percentile(double p) const {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * samples);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen > rank || (seen == samples && seen > 0)) return uint64_t(1) << (b + 1);
+        }
+        return 0;
+    }
+
+    void merge(TimeHistogram const& other) {
+        for (size_t b = 0; b < NUM_BUCKETS; ++b) buckets[b] += other.buckets[b];
+        samples += other.samples;
+        total_ns += other.total_ns;
+    }
+};
+
+/**
+ * @brief  The counters of a single optimizer: the number of calls and a histogram
+        of the time spent for every MetricEvent. Events are recorded into the
+        metrics of the optimizer which currently runs on the calling thread (see
+        MetricsScope), so every thread counts into its own optimizer without any
+        synchronization.
+        Kernel evaluations are much cheaper than two reads of the clock, so only
+        every KERNEL_SAMPLE_RATE-th evaluation is timed. The number of calls is
+        always exact, the kernel time is extrapolated from the samples.
+ */
+class OptimizerMetrics {
+public:
+    static constexpr bool enabled = true;
+    static constexpr uint64_t KERNEL_SAMPLE_RATE = 16;
+
+private:
+    array<uint64_t, NUM_METRIC_EVENTS> counts{};
+    array<TimeHistogram, NUM_METRIC_EVENTS> times;
+
+public:
+    inline void count(MetricEvent e) { ++counts[static_cast<size_t>(e)]; }
+
+    inline void record(MetricEvent e, uint64_t ns) { times[static_cast<size_t>(e)].record(ns); }
+
+    // Number of calls of e
+    inline uint64_t calls(MetricEvent e) const { return counts[static_cast<size_t>(e)]; }
+
+    // Histogram of the timed calls of e
+    inline TimeHistogram const& histogram(MetricEvent e) const { return times[static_cast<size_t>(e)]; }
+
+    // The (estimated) total time spent in e
+    double seconds(MetricEvent e) const {
+        auto const& h = histogram(e);
+        if (h.num_samples() == 0) return 0;
+        return 1e-9 * h.total_nanoseconds() * (static_cast<double>(calls(e)) / h.num_samples());
+    }
+
+    void reset() {
+        *this = OptimizerMetrics();
+    }
+
+    // Adds the counters of other, e.g. to aggregate several optimizers
+    void merge(OptimizerMetrics const& other) {
+        for (size_t i = 0; i < NUM_METRIC_EVENTS; ++i) {
+            counts[i] += other.counts[i];
+            times[i].merge(other.times[i]);
+        }
+    }
+};
+
+/**
+ * @brief  The OptimizerMetrics events of the calling thread are recorded into, or
+        nullptr if no optimizer is running on this thread.
+ */
+inline OptimizerMetrics*& active_metrics() {
+    static thread_local OptimizerMetrics* active = nullptr;
+    return active;
+}
+
+/**
+ * @brief  Routes the events of the calling thread into `metrics' for the lifetime of
+        this object. Scopes nest and the outermost one wins, so e.g. the sieves of
+        SieveStreaming count into the SieveStreaming object and not into themselves.
+ */
+class MetricsScope {
+private:
+    bool owner;
+
+public:
+    explicit MetricsScope(OptimizerMetrics& metrics) : owner(active_metrics() == nullptr) {
+        if (owner) active_metrics() = &metrics;
+    }
+
+    MetricsScope(MetricsScope const&) = delete;
+    MetricsScope& operator=(MetricsScope const&) = delete;
+
+    ~MetricsScope() {
+        if (owner) active_metrics() = nullptr;
+    }
+};
+
+/**
+ * @brief  Counts one call of e and measures the time until this object is destroyed.
+        Does nothing if no MetricsScope is active on the calling thread.
+ */
+class MetricTimer {
+private:
+    OptimizerMetrics* metrics;
+    MetricEvent event;
+    bool timed;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit MetricTimer(MetricEvent e) : metrics(active_metrics()), event(e), timed(false) {
+        if (metrics != nullptr) {
+            metrics->count(e);
+            timed = e != MetricEvent::kernel
+                || metrics->calls(e) % OptimizerMetrics::KERNEL_SAMPLE_RATE == 0;
+            if (timed) start = chrono::steady_clock::now();
+        }
+    }
+
+    MetricTimer(MetricTimer const&) = delete;
+    MetricTimer& operator=(MetricTimer const&) = delete;
+
+    ~MetricTimer() {
+        if (timed) {
+            auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+            metrics->record(event, static_cast<uint64_t>(ns));
+        }
+    }
+};
+
+// Counts one call of e without measuring time
+inline void count_metric(MetricEvent e) {
+    OptimizerMetrics* metrics = active_metrics();
+    if (metrics != nullptr) metrics->count(e);
+}
+
+/**
+ * @brief  Writes the counters of metrics as a JSON object, e.g.
+        {"peek": {"calls": 10, "seconds": 0.001, "p50_ns": 128, "p99_ns": 512}, ...}
+ */
+inline void write_json(ostream& out, OptimizerMetrics const& metrics) {
+    out << "{";
+    for (size_t i = 0; i < NUM_METRIC_EVENTS; ++i) {
+        MetricEvent e = static_cast<MetricEvent>(i);
+        auto const& h = metrics.histogram(e);
+        out << (i == 0 ? "" : ", ") << "\"" << to_string(e) << "\": {\"calls\": " << metrics.calls(e)
+            << ", \"seconds\": " << metrics.seconds(e)
+            << ", \"p50_ns\": " << h.percentile(50)
+            << ", \"p99_ns\": " << h.percentile(99) << "}";
+    }
+    out << "}";
+}
+
+#else
+
+class OptimizerMetrics {
+public:
+    static constexpr bool enabled = false;
+
+    inline uint64_t calls(MetricEvent) const { return 0; }
+    inline double seconds(MetricEvent) const { return 0; }
+    inline void reset() {}
+    inline void merge(OptimizerMetrics const&) {}
+};
+
+class MetricsScope {
+public:
+    explicit MetricsScope(OptimizerMetrics&) {}
+};
+
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricEvent) {}
+};
+
+inline void count_metric(MetricEvent) {}
+
+inline void write_json(ostream& out, OptimizerMetrics const&) {
+    out << "{}";
+}
+
+#endif // SUBMODULAR_METRICS
+
+#endif // METRICS_H
@@ -0,0 +1,103 @@
+#ifndef PREFETCHING_DATA_SOURCE_H
+#define PREFETCHING_DATA_SOURCE_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <exception>
+
+#include "DataTypeHandling.h"
+#include "DataSource.h"
+#include "RingBuffer.h"
+
+using namespace std;
+
+/**
+ * @brief  Wraps another DataSource and reads it ahead on a background producer thread.
+        Elements are handed over through a bounded lock-free SPSCRingBuffer, so
+        parsing / I/O of the wrapped source overlaps with the optimization on the
+        consuming thread, while memory stays bounded by the buffer capacity no matter
+        how long the stream is. Buffer slots are swapped with the consumers vector
+        instead of being copied. Exceptions thrown by the wrapped source are
+        re-thrown by next() on the consumer side.
+ */
+class PrefetchingDataSource : public DataSource {
+private:
+    struct Element {
+        vector<data_t> x;
+        idx_t id;
+    };
+
+    unique_ptr<DataSource> source;
+    SPSCRingBuffer<Element> buffer;
+
+    atomic<bool> done;
+    atomic<bool> stop;
+    exception_ptr error;
+    thread producer;
+
+    void produce() {
+        try {
+            while (!stop.load(memory_order_relaxed)) {
+                Element* slot = buffer.producer_slot();
+                if (slot == nullptr) {
+                    this_thread::yield();
+                    continue;
+                }
+                if (!source->next(slot->x, slot->id)) {
+                    break;
+                }
+                buffer.publish();
+            }
+        }
+        catch (...) {
+            error = current_exception();
+        }
+        done.store(true, memory_order_release);
+    }
+
+public:
+    /**
+     * @brief  Starts prefetching from `source'.
+     * @param  source: The wrapped DataSource. It is owned by this object and must
+            not be used by anyone else afterwards.
+     * @param  capacity: The maximum number of elements which are read ahead.
+     */
+    PrefetchingDataSource(unique_ptr<DataSource> source, size_t capacity = 1024)
+        : source(move(source)), buffer(capacity), done(false), stop(false) {
+        producer = thread(&PrefetchingDataSource::produce, this);
+    }
+
+    PrefetchingDataSource(PrefetchingDataSource const&) = delete;
+    PrefetchingDataSource& operator=(PrefetchingDataSource const&) = delete;
+
+    bool next(vector<data_t>& x, idx_t& id) override {
+        while (true) {
+            Element* slot = buffer.consumer_slot();
+            if (slot != nullptr) {
+                x.swap(slot->x);
+                id = slot->id;
+                buffer.release();
+                return true;
+            }
+            if (done.load(memory_order_acquire)) {
+                // The producer may have published its last elements right before finishing
+                if (!buffer.empty()) continue;
+                if (error) rethrow_exception(error);
+                return false;
+            }
+            this_thread::yield();
+        }
+    }
+
+    // Number of elements which are currently read ahead
+    inline size_t buffered() const { return buffer.size(); }
+
+    ~PrefetchingDataSource() {
+        stop.store(true, memory_order_relaxed);
+        if (producer.joinable()) producer.join();
+    }
+};
+
+#endif // PREFETCHING_DATA_SOURCE_H
@@ -7,6 +7,7 @@
 #include <numeric>
 #include <random>
 #include <unordered_set>
+#include <sstream>
 
 
 /**
@@ -19,7 +20,7 @@
  *  - Function Types: nonnegative submodular functions
  *
  * See also :
- *   - Feige, U., Mirrokni, V. S., & Vondrk, J. (2011). Maximizing non-monotone submodular functions. SIAM Journal on Computing. https://doi.org/10.1137/090779346
+ *   - Feige, U., Mirrokni, V. S., & Vondrák, J. (2011). Maximizing non-monotone submodular functions. SIAM Journal on Computing. https://doi.org/10.1137/090779346
  *   - Vitter, J. S. (1985). Random Sampling with a Reservoir. ACM Transactions on Mathematical Software (TOMS). https://doi.org/10.1145/3147.3165
  * @note
  */
@@ -52,6 +53,7 @@ protected:
     };
 
 public:
+    using SubmodularOptimizer::fit;
 
     /**
      * @brief Construct a new Random object.
@@ -78,13 +80,17 @@ public:
     * @param iterations: Has no effect. Random samples K elements, no iterations required.
     */
     void fit(vector<vector<data_t>> const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        MetricsScope scope(metrics);
         if (X.size() < K) {
             K = X.size();
         }
         vector<unsigned int> indices = sample_without_replacement(K, X.size(), generator);
 
         for (auto i : indices) {
-            f->update(solution, X[i], solution.size());
+            {
+                MetricTimer timer(MetricEvent::update);
+                f->update(solution, X[i], solution.size());
+            }
             solution.push_back(X[i]);
             if (ids.size() >= i) {
                 this->ids.push_back(ids[i]);
@@ -93,8 +99,12 @@ public:
         }
 
         cnt = X.size();
-        fval = f->operator()(solution);
+        {
+            MetricTimer timer(MetricEvent::evaluate);
+            fval = f->operator()(solution);
+        }
         is_fitted = true;
+        publish_snapshot();
     }
 
     void fit(vector<vector<data_t>> const& X, unsigned int iterations = 1) {
@@ -104,32 +114,180 @@ public:
     }
 
     /**
-     * @brief ʹеһݡʹˮس㷨Եǰгͨ
-     *        'get_solution'ʵǰ⡣
+    * @brief  Randomly pick K elements from a view of the data set. Only the K sampled rows are copied.
+    * @note
+    * @param  X A view of the entire data set
+    * @param iterations: Has no effect. Random samples K elements, no iterations required.
+    */
+    void fit(DatasetView const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        MetricsScope scope(metrics);
+        if (X.size() < K) {
+            K = X.size();
+        }
+        vector<unsigned int> indices = sample_without_replacement(K, X.size(), generator);
+
+        for (auto i : indices) {
+            vector<data_t> x(X.row(i), X.row(i) + X.dimension());
+            {
+                MetricTimer timer(MetricEvent::update);
+                f->update(solution, x, solution.size());
+            }
+            solution.push_back(move(x));
+            if (ids.size() > i) {
+                this->ids.push_back(ids[i]);
+            }
+        }
+
+        cnt = X.size();
+        {
+            MetricTimer timer(MetricEvent::evaluate);
+            fval = f->operator()(solution);
+        }
+        is_fitted = true;
+        publish_snapshot();
+    }
+
+    void fit(DatasetView const& X, unsigned int iterations = 1) {
+        vector<idx_t> ids;
+        fit(X, ids, iterations);
+    }
+
+    /**
+     * @brief Merges the reservoir of another Random optimizer, e.g. of another shard of the
+              stream. If this optimizer has seen n1 and other n2 elements, the merged reservoir
+              takes K draws without replacement from the n1 + n2 elements: each draw comes from
+              this stream with probability (remaining elements of this stream) / (remaining
+              elements of both streams), and the drawn elements are taken uniformly from the
+              corresponding reservoir. If both reservoirs are uniform samples of their streams,
+              the merged reservoir is a uniform sample of their union, exactly as if one Random
+              had consumed both streams. Merging is therefore associative and shards can be
+              reduced in any order. The expected 1/4 guarantee for a uniform sample still holds.
+     * @note  The function value is re-computed from scratch with K updates.
+     * @param other The optimizer to merge, it is not changed. Must have the same K.
+     */
+    void merge(Random const& other) {
+        check_mergeable(other);
+        uint64_t n1 = max<uint64_t>(cnt, solution.size());
+        uint64_t n2 = max<uint64_t>(other.cnt, other.solution.size());
+
+        vector<size_t> mine(solution.size()), theirs(other.solution.size());
+        iota(mine.begin(), mine.end(), 0);
+        iota(theirs.begin(), theirs.end(), 0);
+        shuffle(mine.begin(), mine.end(), generator);
+        shuffle(theirs.begin(), theirs.end(), generator);
+
+        bool with_ids = ids.size() == solution.size() && other.ids.size() == other.solution.size();
+        vector<vector<data_t>> merged;
+        vector<idx_t> merged_ids;
+        size_t a = 0, b = 0;
+        while (merged.size() < K && (a < mine.size() || b < theirs.size())) {
+            bool take_mine;
+            if (a == mine.size()) take_mine = false;
+            else if (b == theirs.size()) take_mine = true;
+            else take_mine = uniform_int_distribution<uint64_t>(1, (n1 - a) + (n2 - b))(generator) <= n1 - a;
+
+            if (take_mine) {
+                merged.push_back(move(solution[mine[a]]));
+                if (with_ids) merged_ids.push_back(ids[mine[a]]);
+                ++a;
+            }
+            else {
+                merged.push_back(other.solution[theirs[b]]);
+                if (with_ids) merged_ids.push_back(other.ids[theirs[b]]);
+                ++b;
+            }
+        }
+
+        // f keeps the state of the old solution, so it is rebuilt from a fresh clone
+        f = f->clone();
+        solution.clear();
+        for (auto& x : merged) {
+            MetricTimer timer(MetricEvent::update);
+            f->update(solution, x, solution.size());
+            solution.push_back(move(x));
+        }
+        ids = move(merged_ids);
+        {
+            MetricTimer timer(MetricEvent::evaluate);
+            fval = f->operator()(solution);
+        }
+        cnt = n1 + n2;
+        is_fitted = is_fitted || other.is_fitted;
+        publish_snapshot();
+    }
+
+    /**
+     * @brief Throws an exception. Reservoir sampling replaces elements of the solution, so
+              the first k elements are no sample for k. Please use one Random per K.
+     */
+    vector<Summary> get_solutions(vector<unsigned int> const& Ks) const override {
+        throw runtime_error("Random does not keep nested solutions, please use one Random optimizer per K.");
+    }
+
+    /**
+     * @brief Writes the state of this optimizer. Reservoir sampling replaces elements of the
+              solution, so the checkpoint is always a full snapshot, also if `incremental' is set.
+     */
+    void save(BinaryWriter& out, bool incremental = false) override {
+        save_state(out, 0);
+        out.write<uint32_t>(cnt);
+        ostringstream state;
+        state << generator;
+        out.write_string(state.str());
+    }
+
+    void load(BinaryReader& in) override {
+        load_state(in);
+        cnt = in.read<uint32_t>();
+        istringstream state(in.read_string());
+        state >> generator;
+    }
+
+    /**
+     * @brief 使用数据流中的下一个数据。这里使用蓄水池抽样算法对当前解进行抽样。通过
+     *        'get_solution'访问当前解。
      *
-     * @param x һݵĳá
+     * @param x 数据流中下一个数据的常引用。
      */
     void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+        if (is_duplicate(x)) {
+            return;
+        }
+        MetricsScope scope(metrics);
+        bool changed = true;
         if (solution.size() < K) {
-            //ֱǰKԪصǰ
+            //直接添加前K个元素到当前解
+            MetricTimer timer(MetricEvent::update);
             f->update(solution, x, solution.size());
             solution.push_back(x);
             if (id.has_value()) ids.push_back(id.value());
+            accepted();
         }
         else {
-            //½ĸʽ滻
+            //利用逐渐下降的概率进行替换抽样
             unsigned int j = uniform_int_distribution<>(1, cnt)(generator);
             if (j <= K) {
+                MetricTimer timer(MetricEvent::update);
                 f->update(solution, x, j - 1);
                 if (id.has_value()) ids[j - 1] = id.value();
                 solution[j - 1] = x;
+                accepted();
+            }
+            else {
+                changed = false;
             }
         }
 
-        // µǰֵ
-        fval = f->operator()(solution);
+        // 更新当前函数值
+        {
+            MetricTimer timer(MetricEvent::evaluate);
+            fval = f->operator()(solution);
+        }
         is_fitted = true;
         ++cnt;
+        if (changed) {
+            publish_snapshot();
+        }
     }
 };
 
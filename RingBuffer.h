@@ -0,0 +1,210 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+using namespace std;
+
+/**
+ * @brief  A bounded, lock-free single-producer / single-consumer ring buffer. The
+        slots are allocated once and are accessed in-place: the producer fills the
+        slot returned by `producer_slot' and makes it visible via `publish', the
+        consumer reads the slot returned by `consumer_slot' and hands it back via
+        `release'. Because slots are re-used, elements which own memory (e.g. a
+        vector<data_t>) keep their capacity and the buffer does not allocate in
+        steady state. Exactly one thread may act as producer and exactly one thread
+        as consumer at any time.
+ */
+template <typename T>
+class SPSCRingBuffer {
+private:
+    // Keeps head and tail on different cache lines so producer and consumer do not
+    // invalidate each others cache on every operation
+    static constexpr size_t CACHE_LINE = 64;
+
+    vector<T> slots;
+    size_t mask;
+
+    alignas(CACHE_LINE) atomic<size_t> head;    // next slot to be read
+    alignas(CACHE_LINE) atomic<size_t> tail;    // next slot to be written
+
+public:
+    /**
+     * @brief  Creates a ring buffer holding at least `capacity' elements. The
+            capacity is rounded up to the next power of two.
+     */
+    explicit SPSCRingBuffer(size_t capacity) : head(0), tail(0) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        slots.resize(n);
+        mask = n - 1;
+    }
+
+    inline size_t capacity() const { return slots.size(); }
+
+    // Number of elements which are currently buffered (approximate if called concurrently)
+    inline size_t size() const {
+        return tail.load(memory_order_acquire) - head.load(memory_order_acquire);
+    }
+
+    inline bool empty() const { return size() == 0; }
+
+    /**
+     * @brief  Producer: returns the next free slot or nullptr if the buffer is full.
+     */
+    inline T* producer_slot() {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size()) {
+            return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    /**
+     * @brief  Producer: makes the slot returned by `producer_slot' visible to the consumer.
+     */
+    inline void publish() {
+        tail.store(tail.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    /**
+     * @brief  Consumer: returns the oldest filled slot or nullptr if the buffer is empty.
+     */
+    inline T* consumer_slot() {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    /**
+     * @brief  Consumer: hands the slot returned by `consumer_slot' back to the producer.
+     */
+    inline void release() {
+        head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+};
+
+/**
+ * @brief  A bounded, lock-free multi-producer / single-consumer ring buffer (the bounded
+        queue of D. Vyukov). Every slot carries a sequence number which tells producers
+        whether the slot is free and the consumer whether it was published. Producers
+        claim a slot with a single compare-and-swap and fill it in-place, so a full
+        buffer is reported immediately instead of blocking the producer. As for the
+        SPSCRingBuffer, slots are re-used and keep their capacity. Any number of
+        threads may produce, exactly one thread may consume at any time.
+ * @note   A producer which claimed a slot but has not filled it yet delays the consumer
+        (not the other producers) until it is done.
+ */
+template <typename T>
+class MPSCRingBuffer {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Slot {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t num_slots;
+    size_t mask;
+
+    alignas(CACHE_LINE) atomic<size_t> head;    // next slot to be read
+    alignas(CACHE_LINE) atomic<size_t> tail;    // next slot to be claimed by a producer
+
+public:
+    /**
+     * @brief  Creates a ring buffer holding at least `capacity' elements. The
+            capacity is rounded up to the next power of two.
+     */
+    explicit MPSCRingBuffer(size_t capacity) : head(0), tail(0) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        slots.reset(new Slot[n]);
+        num_slots = n;
+        mask = n - 1;
+        for (size_t i = 0; i < n; ++i) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    MPSCRingBuffer(MPSCRingBuffer const&) = delete;
+    MPSCRingBuffer& operator=(MPSCRingBuffer const&) = delete;
+
+    inline size_t capacity() const { return num_slots; }
+
+    // Number of claimed but not yet released slots (approximate if called concurrently)
+    inline size_t size() const {
+        size_t h = head.load(memory_order_acquire);
+        size_t t = tail.load(memory_order_acquire);
+        return t > h ? t - h : 0;
+    }
+
+    inline bool empty() const { return size() == 0; }
+
+    // Total number of slots claimed by producers so far, i.e. the position of the next claim
+    inline size_t claimed() const { return tail.load(memory_order_acquire); }
+
+    // Total number of slots released by the consumer so far. Slots are released in the order
+    // they were claimed, so released() >= n means that the first n slots were consumed
+    inline size_t released() const { return head.load(memory_order_acquire); }
+
+    /**
+     * @brief  Producer: claims the next free slot, fills it by calling `fill(T&)' and makes
+            it visible to the consumer. Never blocks.
+     * @param  fill: Writes the element into the slot. Must not throw, the slot would
+            never be published otherwise.
+     * @retval false if the buffer is full, `fill' is not called in this case.
+     */
+    template <typename Fill>
+    bool try_push(Fill&& fill) {
+        size_t t = tail.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[t & mask];
+            size_t seq = slot.sequence.load(memory_order_acquire);
+            if (seq == t) {
+                if (tail.compare_exchange_weak(t, t + 1, memory_order_relaxed)) {
+                    fill(slot.value);
+                    slot.sequence.store(t + 1, memory_order_release);
+                    return true;
+                }
+                // t was reloaded by the failed compare-and-swap
+            }
+            else if (seq < t) {
+                // The slot still holds the element of the previous round
+                return false;
+            }
+            else {
+                t = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief  Consumer: returns the oldest published slot or nullptr if there is none.
+     */
+    inline T* consumer_slot() {
+        size_t h = head.load(memory_order_relaxed);
+        Slot& slot = slots[h & mask];
+        if (slot.sequence.load(memory_order_acquire) != h + 1) {
+            return nullptr;
+        }
+        return &slot.value;
+    }
+
+    /**
+     * @brief  Consumer: hands the slot returned by `consumer_slot' back to the producers.
+     */
+    inline void release() {
+        size_t h = head.load(memory_order_relaxed);
+        slots[h & mask].sequence.store(h + num_slots, memory_order_release);
+        head.store(h + 1, memory_order_release);
+    }
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,41 @@
+#ifndef ROW_HASH_H
+#define ROW_HASH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "DataTypeHandling.h"
+
+using namespace std;
+
+/**
+ * @brief  64 bit hash of the bit patterns of a row. Rows which compare equal
+        element-wise have the same hash (-0.0 and 0.0 are treated as the same value).
+        NaN values are hashed by their bit pattern.
+ * @param  x: Pointer to the first feature.
+ * @param  D: Number of features.
+ * @retval The hash value.
+ */
+inline uint64_t hash_row(data_t const* x, size_t D) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (D * 0xC2B2AE3D27D4EB4Full);
+    for (size_t d = 0; d < D; ++d) {
+        data_t v = x[d] == 0 ? data_t(0) : x[d];
+        uint64_t bits = 0;
+        memcpy(&bits, &v, sizeof(data_t));
+        // splitmix64 finalizer on the mixed-in feature
+        h ^= bits + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+inline uint64_t hash_row(vector<data_t> const& x) {
+    return hash_row(x.data(), x.size());
+}
+
+#endif // ROW_HASH_H
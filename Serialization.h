@@ -0,0 +1,97 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "DataTypeHandling.h"
+
+using namespace std;
+
+/**
+ * @brief  Writes plain values and vectors of plain values to a binary stream in host
+        byte order. Used by SubmodularFunction::save and SubmodularOptimizer::save.
+ */
+class BinaryWriter {
+private:
+    ostream& out;
+
+public:
+    BinaryWriter(ostream& out) : out(out) {}
+
+    template <typename T>
+    inline void write(T const& value) {
+        static_assert(is_trivially_copyable<T>::value, "BinaryWriter: Only trivially copyable types can be written.");
+        out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    inline void write(T const* values, size_t n) {
+        static_assert(is_trivially_copyable<T>::value, "BinaryWriter: Only trivially copyable types can be written.");
+        out.write(reinterpret_cast<char const*>(values), n * sizeof(T));
+    }
+
+    // Writes the length of v followed by its elements
+    template <typename T>
+    inline void write_vector(vector<T> const& v) {
+        write<uint64_t>(v.size());
+        write(v.data(), v.size());
+    }
+
+    inline void write_string(string const& s) {
+        write<uint64_t>(s.size());
+        write(s.data(), s.size());
+    }
+
+    inline ostream& stream() { return out; }
+};
+
+/**
+ * @brief  Reads what a BinaryWriter has written. Throws a runtime_error if the stream
+        ends early.
+ */
+class BinaryReader {
+private:
+    istream& in;
+
+public:
+    BinaryReader(istream& in) : in(in) {}
+
+    template <typename T>
+    inline void read(T* values, size_t n) {
+        static_assert(is_trivially_copyable<T>::value, "BinaryReader: Only trivially copyable types can be read.");
+        in.read(reinterpret_cast<char*>(values), n * sizeof(T));
+        if (!in) {
+            throw runtime_error("BinaryReader: Unexpected end of stream.");
+        }
+    }
+
+    template <typename T>
+    inline T read() {
+        T value;
+        read(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    inline vector<T> read_vector() {
+        vector<T> v(read<uint64_t>());
+        read(v.data(), v.size());
+        return v;
+    }
+
+    inline string read_string() {
+        string s(read<uint64_t>(), '\0');
+        read(&s[0], s.size());
+        return s;
+    }
+
+    inline istream& stream() { return in; }
+};
+
+#endif // SERIALIZATION_H
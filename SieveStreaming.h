@@ -3,10 +3,12 @@
 
 #include "DataTypeHandling.h"
 #include "SubmodularOptimizer.h"
+#include "LatencyTrace.h"
 #include <algorithm>
 #include <numeric>
 #include <random>
 #include <unordered_set>
+#include <limits>
 
 #include <string>
 using namespace std;
@@ -21,8 +23,8 @@ using namespace std;
  * @return std::vector<data_t> The set of sampled thresholds
  */
 /*
-* ½lowerϽupperԼepsilon[lower,upper](1+)^i
-*  O
+* 给定下界lower、上界upper以及调整参数epsilon，返回[lower,upper]间的(1+ε)^i
+* 即集合 O
 */
 inline vector<data_t> thresholds(data_t lower, data_t upper, data_t epsilon) {
     vector<data_t> ts;
@@ -67,12 +69,15 @@ private:
 
     /**
      * @brief A single Sieve with its own threshold
-     * ɸӶӦֵ
+     * 单个筛子对应单个阈值
      */
     class Sieve : public SubmodularOptimizer {
     public:
 
-        data_t threshold;//ֵ
+        data_t threshold;//阈值
+
+        // The memory of this sieve in the running total of SieveStreaming, see account()
+        size_t accounted = 0;
 
         /**
          * @brief Construct a new Sieve object
@@ -103,7 +108,7 @@ private:
         /**
          * @brief Throws an exception since fit() should not be used directly here. Sieves are
                   not meant to be used on their own, but only through SieveStreaming.
-         *  fit()ֱʹáSieveӦͨSieveStreamingá
+         *  fit()不在这儿直接使用。Sieve类应该通过SieveStreaming类调用。
          * @param X A constant reference to the entire data set
          */
         void fit(vector<vector<data_t>> const& X, unsigned int iterations = 1) {
@@ -114,36 +119,208 @@ private:
          * @brief Consume the next object in the data stream. This call compares the marginal
                   gain against the given threshold and add the current item to the current
                   solution if it exceeds the given threshold.
-         *  ʹеһ󡣱Ƚϱ߼ֵ˸ֵ
-            ǰӵǰ⡣
+         *  使用数据流中的下一个对象。比较边际增益与给定的阈值，如果超过了该阈值便
+            将当前对象添加到当前解。
          * @param x A constant reference to the next object on the stream.
          */
         void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+            offer(x, id, numeric_limits<data_t>::infinity());
+        }
+
+        /**
+         * @brief Like next(), but x is skipped without a function query if its gain, which
+                  is at most gain_bound, cannot reach tau.
+         * @retval true if f was queried.
+         */
+        bool offer(vector<data_t> const& x, optional<idx_t> const id, data_t gain_bound) {
+            is_fitted = true;
             unsigned int Kcur = solution.size();
             if (Kcur < K) {
-                data_t fdelta = f->peek(solution, x, solution.size()) - fval;//߼
-                data_t tau = (threshold / 2.0 - fval) / static_cast<data_t>(K - Kcur);//ֵ
+                data_t tau = (threshold / 2.0 - fval) / static_cast<data_t>(K - Kcur);//给定阈值τ
+                if (gain_bound + BOUND_SLACK * (abs(gain_bound) + abs(fval)) < tau) {
+                    return false;
+                }
+                data_t fdelta;
+                {
+                    // Only gains of at least tau matter, so f may reject x early
+                    MetricTimer timer(MetricEvent::peek);
+                    fdelta = f->peek_with_threshold(solution, x, solution.size(), fval + tau) - fval;
+                }//边际增益
 
-                if (fdelta >= tau) {//߼ֵӾͽǰԪxӽǰsolution
-                    f->update(solution, x, solution.size());
+                if (fdelta >= tau) {//如果边际增益大于阈值τ就将当前元素x添加进当前解solution
+                    {
+                        MetricTimer timer(MetricEvent::update);
+                        f->update(solution, x, solution.size());
+                    }
                     solution.push_back(x);
 
                     if (id.has_value()) ids.push_back(id.value());
                     fval += fdelta;
+                    prefix_fvals.push_back(fval);
                 }
+                return true;
             }
-            is_fitted = true;
-
-           
+            return false;
         }
     };
 
 protected:
     // A list of all sieves
-    //Ҫжɸӽй
+    //需要并行运行多个筛子进行过滤
     vector<unique_ptr<Sieve>> sieves;
 
+    // Use the singleton value of every element to skip sieves, see enable_singleton_bound()
+    bool singleton_bound = true;
+
+    // The indices of all sieves which are not full yet, sorted by threshold
+    vector<size_t> active;
+    bool active_dirty = true;
+
+    // The indices of the sieves which accepted the current element
+    vector<size_t> changed;
+
+    void update_active() {
+        active.clear();
+        for (size_t i = 0; i < sieves.size(); ++i) {
+            if (sieves[i]->solution.size() < K) active.push_back(i);
+        }
+        stable_sort(active.begin(), active.end(),
+            [this](size_t a, size_t b) { return sieves[a]->threshold < sieves[b]->threshold; }
+        );
+        active_dirty = false;
+    }
+
+    // Per-element latency trace, see enable_tracing()
+    unique_ptr<LatencyTrace> trace;
+
+    // The maximum singleton value and the epsilon of the initial threshold grid
+    data_t m;
+    data_t epsilon;
+
+    // The smallest sampling probability of the stream, see set_sampling_probability().
+    // The threshold grid covers [sampling * m, K * m]
+    data_t sampling = 1;
+
+    // Memory budget in bytes, see set_memory_budget(). 0 means no budget
+    size_t memory_budget = 0;
+
+    // Running total of the memory of all sieves, which is only kept while a budget is set.
+    // It is updated whenever a sieve is queried, created or freed, so that checking the
+    // budget does not visit every sieve
+    size_t sieve_bytes = 0;
+
+    inline size_t sieve_memory(Sieve const& s) const {
+        return s.get_memory_bytes() - sizeof(SubmodularOptimizer) + sizeof(Sieve);
+    }
+
+    // Updates the running total after sieve s was queried or created
+    inline void account(Sieve& s) {
+        if (memory_budget == 0) return;
+        size_t bytes = sieve_memory(s);
+        sieve_bytes = sieve_bytes - s.accounted + bytes;
+        s.accounted = bytes;
+    }
+
+    // Recomputes the running total from all sieves
+    void recount() {
+        sieve_bytes = 0;
+        for (auto& s : sieves) {
+            s->accounted = 0;
+            account(*s);
+        }
+    }
+
+    // The memory of this optimizer without its sieves
+    size_t own_memory() const {
+        return SubmodularOptimizer::get_memory_bytes() - sizeof(SubmodularOptimizer) + sizeof(SieveStreaming)
+            + sieves.capacity() * sizeof(unique_ptr<Sieve>) + (active.capacity() + changed.capacity()) * sizeof(size_t);
+    }
+
+    // get_memory_bytes() from the running total, i.e. in O(K) instead of O(#sieves)
+    inline size_t budget_memory() const {
+        return own_memory() + sieve_bytes;
+    }
+
+    // Number of times the threshold grid was coarsened to meet the budget. The
+    // remaining thresholds are (1 + epsilon)^i for multiples i of 2^coarsening
+    unsigned int coarsening = 0;
+
+    // True if threshold t is on the current grid, i.e. (1 + epsilon)^i for a multiple i of 2^coarsening
+    inline bool on_grid(data_t t) const {
+        return llround(log(t) / log(1.0 + epsilon)) % (int64_t(1) << coarsening) == 0;
+    }
+
+    // Removes all sieves for which drop(sieve) is true, keeping the order of the others.
+    // Returns the number of removed sieves
+    template <typename Predicate>
+    size_t evict(Predicate drop) {
+        auto end = remove_if(sieves.begin(), sieves.end(), [this, &drop](auto const& s) {
+            if (!drop(*s)) return false;
+            sieve_bytes -= memory_budget > 0 ? s->accounted : 0;
+            return true;
+        });
+        size_t removed = sieves.end() - end;
+        if (removed > 0) {
+            sieves.erase(end, sieves.end());
+            active_dirty = true;
+        }
+        return removed;
+    }
+
+    // New sieves for the thresholds of the current grid in [p * m, sampling * m), in ascending order
+    vector<unique_ptr<Sieve>> sieves_below(data_t p) const {
+        vector<unique_ptr<Sieve>> lower;
+        for (auto t : thresholds(p * m, sampling * m, epsilon)) {
+            bool any = any_of(sieves.begin(), sieves.end(), [t](auto const& s) { return s->threshold == t; });
+            if (t < sampling * m && !any && on_grid(t)) {
+                lower.push_back(make_unique<Sieve>(K, *f, t));
+            }
+        }
+        return lower;
+    }
+
+    // Inserts sieves whose thresholds are below all others, so the sieves stay sorted by threshold
+    void prepend(vector<unique_ptr<Sieve>> lower) {
+        if (lower.empty()) return;
+        for (auto& s : sieves) {
+            lower.push_back(move(s));
+        }
+        sieves = move(lower);
+        active_dirty = true;
+        recount();
+    }
+
+    // Frees sieves until the memory is within the budget, see set_memory_budget().
+    // Returns the number of freed sieves
+    size_t enforce_memory_budget() {
+        if (memory_budget == 0 || budget_memory() <= memory_budget) {
+            return 0;
+        }
+        // Full sieves never change again, and this optimizer keeps the best solution
+        size_t removed = evict([this](Sieve const& s) { return s.solution.size() == K; });
+        if (budget_memory() <= memory_budget) {
+            return removed;
+        }
+        // OPT >= fval, so the sieve the guarantee relies on has a threshold >= fval / (1 + epsilon)
+        data_t lowest = fval / (1.0 + get_epsilon());
+        removed += evict([lowest](Sieve const& s) { return s.threshold < lowest; });
+
+        while (budget_memory() > memory_budget && sieves.size() > 1 && coarsening < 62) {
+            ++coarsening;
+            auto coarse = [this](Sieve const& s) { return on_grid(s.threshold); };
+            // Gaps left by steps 1 and 2 may leave no threshold on the coarser grid, keep the largest then
+            Sieve const* largest = max_element(sieves.begin(), sieves.end(),
+                [](auto const& a, auto const& b) { return a->threshold < b->threshold; }
+            )->get();
+            bool any = any_of(sieves.begin(), sieves.end(), [&coarse](auto const& s) { return coarse(*s); });
+            removed += evict([&](Sieve const& s) { return any ? !coarse(s) : &s != largest; });
+        }
+        return removed;
+    }
+
 public:
+    // Relative slack of the singleton bound, which covers rounding errors of the gains
+    static constexpr data_t BOUND_SLACK = 1e-6;
 
     /**
      * @brief Construct a new Sieve Streaming object
@@ -156,7 +333,7 @@ public:
      * @param m The maximum value of the singleton set, m = max_e f({e})
      * @param epsilon The sampling accuracy for threshold generation
      */
-    SieveStreaming(unsigned int K, SubmodularFunction& f, data_t m, data_t epsilon) : SubmodularOptimizer(K, f) {
+    SieveStreaming(unsigned int K, SubmodularFunction& f, data_t m, data_t epsilon) : SubmodularOptimizer(K, f), m(m), epsilon(epsilon) {
         vector<data_t> ts = thresholds(m, K * m, epsilon);
 
         for (auto t : ts) {
@@ -172,26 +349,244 @@ public:
      * @param m The maximum value of the singleton set, m = max_e f({e})
      * @param epsilon The sampling accuracy for threshold generation
      */
-    SieveStreaming(unsigned int K, function<data_t(vector<vector<data_t>> const&)> f, data_t m, data_t epsilon) : SubmodularOptimizer(K, f) {
+    SieveStreaming(unsigned int K, function<data_t(vector<vector<data_t>> const&)> f, data_t m, data_t epsilon) : SubmodularOptimizer(K, f), m(m), epsilon(epsilon) {
         vector<data_t> ts = thresholds(m, K * m, epsilon);
         for (auto t : ts) {
             sieves.push_back(make_unique<Sieve>(K, f, t));
         }
     }
-    //رѡ𰸼
+    /**
+     * @brief  Starts recording the duration of every call of next() together with the
+            number of sieves touched, created and deleted. Only the last `capacity'
+            calls are kept, see LatencyTrace. Tracing is off by default.
+     * @param  capacity: The size of the ring buffer.
+     */
+    void enable_tracing(size_t capacity = 65536) {
+        trace.reset(new LatencyTrace(capacity));
+    }
+
+    // The recorded trace or nullptr if tracing was not enabled
+    LatencyTrace const* get_trace() const {
+        return trace.get();
+    }
+
+    /**
+     * @brief  The grid guesses OPT in [m, K * m], but OPT of a stream which is sampled with
+            probability p can be about p * OPT and thus fall below m. Then no sieve holds
+            the guess the 1/2 - epsilon guarantee depends on. Hence, the grid is extended
+            down to p * m, except for guesses below the current fval. The new sieves are
+            seeded with the elements stored so far (the best solution and all sieves, as
+            in merge()) and see all following elements.
+     * @param  p: The smallest sampling probability in (0, 1].
+     */
+    void set_sampling_probability(data_t p) override {
+        if (!(p > 0 && p <= 1)) {
+            throw runtime_error("SieveStreaming::set_sampling_probability: The probability must be in (0, 1].");
+        }
+        if (p >= sampling) {
+            return;
+        }
+        vector<unique_ptr<Sieve>> extended = sieves_below(p);
+        sampling = p;
+        // OPT >= fval, so guesses below fval / (1 + epsilon) are not needed (see enforce_memory_budget)
+        data_t lowest = fval / (1.0 + get_epsilon());
+        extended.erase(remove_if(extended.begin(), extended.end(),
+            [lowest](auto const& s) { return s->threshold < lowest; }
+        ), extended.end());
+        if (extended.empty()) {
+            return;
+        }
+
+        vector<SubmodularOptimizer const*> sources = { this };
+        for (auto const& s : sieves) {
+            sources.push_back(s.get());
+        }
+        vector<vector<data_t>> X;
+        vector<optional<idx_t>> X_ids;
+        collect_candidates(sources, X, X_ids);
+        for (auto& s : extended) {
+            for (size_t i = 0; i < X.size(); ++i) {
+                s->next(X[i], X_ids[i]);
+            }
+            if (s->get_fval() > fval) {
+                adopt(*s);
+            }
+        }
+        prepend(move(extended));
+        enforce_memory_budget();
+    }
+
+    // The smallest sampling probability the threshold grid covers, see set_sampling_probability()
+    inline data_t get_sampling_probability() const {
+        return sampling;
+    }
+
+    /**
+     * @brief  For a submodular f with f(empty set) = 0 the singleton value f({x}) bounds the
+            gain of x for every solution. Hence, with the bound enabled, every element costs
+            one extra query f({x}), but only sieves whose current tau does not exceed f({x})
+            are queried at all, and full sieves are never visited. The solutions are the
+            same as without the bound. Enabled by default.
+     * @param  enable: true to use the bound.
+     */
+    void enable_singleton_bound(bool enable = true) {
+        singleton_bound = enable;
+    }
+
+    /**
+     * @brief  Limits the memory of all sieves, see get_memory_bytes(). Every sieve holds a
+            clone of f and up to K elements. For FastIVM the clone holds two packed lower
+            triangles which grow with the sieve, i.e. O(n^2) for a sieve with n elements,
+            so sieves which accept few elements stay small. Without a budget the memory
+            grows with up to K * log(K) / epsilon elements (and O(K^2) per full FastIVM
+            sieve). Whenever the memory exceeds the budget, sieves are freed in this order:
+              1. Full sieves. They cannot accept elements anymore and the best solution
+                 is kept by this optimizer, so the guarantee is not affected.
+              2. Sieves with a threshold below fval / (1 + epsilon). Since OPT >= fval,
+                 none of them is the sieve with a threshold in [OPT / (1 + epsilon), OPT]
+                 the guarantee relies on.
+              3. Every second remaining threshold, i.e. the grid is coarsened from
+                 epsilon to (1 + epsilon)^2 - 1. This is repeated until the budget is met,
+                 and the guarantee becomes 1/2 - get_epsilon().
+            Steps 1 and 3 also drop candidates of get_solutions() and merge().
+     * @note   Coarsening keeps at least one sieve, so a budget smaller than a single sieve
+            may be exceeded until that sieve is full. The budget is checked against a
+            running total, which is updated for every queried sieve, so the check does
+            not visit all sieves.
+     * @param  bytes: The budget in bytes, 0 removes the budget.
+     */
+    void set_memory_budget(size_t bytes) {
+        memory_budget = bytes;
+        recount();
+        enforce_memory_budget();
+    }
+
+    inline size_t get_memory_budget() const { return memory_budget; }
+
+    // The accuracy of the current threshold grid, which grows if the grid is coarsened to meet the memory budget
+    inline data_t get_epsilon() const {
+        return coarsening == 0 ? epsilon : pow(1.0 + epsilon, static_cast<data_t>(int64_t(1) << coarsening)) - 1.0;
+    }
+
+    /**
+     * @brief Writes the state of all sieves. Sieves only append to their solution, so an
+     *        incremental checkpoint contains the elements each sieve has accepted since
+     *        the last checkpoint. The best solution is always written in full.
+     */
+    void save(BinaryWriter& out, bool incremental = false) override {
+        save_state(out, 0);
+        out.write<uint32_t>(coarsening);
+        out.write<data_t>(sampling);
+        out.write<uint64_t>(sieves.size());
+        for (auto& s : sieves) {
+            out.write<data_t>(s->threshold);
+            s->save(out, incremental);
+        }
+    }
+
+    // Sieves which were freed to meet the memory budget are missing in the checkpoint and are freed here as well
+    void load(BinaryReader& in) override {
+        load_state(in);
+        coarsening = in.read<uint32_t>();
+        data_t p = in.read<data_t>();
+        if (p < sampling) {
+            // The sieves of the extended grid are restored below
+            prepend(sieves_below(p));
+            sampling = p;
+        }
+        size_t num_sieves = in.read<uint64_t>();
+        vector<unique_ptr<Sieve>> restored;
+        size_t j = 0;
+        for (size_t i = 0; i < num_sieves; ++i) {
+            data_t t = in.read<data_t>();
+            while (j < sieves.size() && sieves[j]->threshold != t) {
+                ++j;
+            }
+            if (j == sieves.size()) {
+                throw runtime_error("SieveStreaming::load: The checkpoint has different thresholds, please use the same K, m and epsilon.");
+            }
+            sieves[j]->load(in);
+            restored.push_back(move(sieves[j++]));
+        }
+        sieves = move(restored);
+        active_dirty = true;
+        recount();
+    }
+
+    /**
+     * @brief Merges the summary of another SieveStreaming, e.g. of another shard of the same
+     *        stream, into this one. The distinct elements stored by other (its best solution
+     *        first, then its sieves) are streamed through next() as if they were appended to
+     *        the stream of this optimizer, and the best solution of other is taken over if it
+     *        is better. Hence, after merging
+     *          - fval >= max(fval, other.fval), and
+     *          - the solution is a (1/2 - epsilon) approximation of the stream of this
+     *            optimizer followed by the candidates of other.
+     *        Reducing shards S_1, ..., S_m in a tree therefore yields at least
+     *        max_i (1/2 - epsilon) OPT(S_i), and (1/2 - epsilon) OPT(S_root + C), where C are
+     *        the candidates of all other shards. The candidates of a shard contain the
+     *        solutions of all its sieves, so the result is usually much closer to a single
+     *        pass over all shards than the max alone suggests.
+     * @note  Costs one next() per candidate, i.e. O(K * log(K) / epsilon) elements.
+     * @param other The optimizer to merge, it is not changed. Must have the same K, m and epsilon.
+     */
+    void merge(SieveStreaming const& other) {
+        check_mergeable(other);
+        // The guarantee relies on the same grid of OPT guesses in all shards
+        if (other.m != m || other.epsilon != epsilon) {
+            throw runtime_error("SieveStreaming::merge: Both optimizers must have the same m and epsilon (m = " + to_string(m) + " vs. " + to_string(other.m) + ", epsilon = " + to_string(epsilon) + " vs. " + to_string(other.epsilon) + ").");
+        }
+        vector<SubmodularOptimizer const*> sources = { &other };
+        for (auto const& s : other.sieves) {
+            sources.push_back(s.get());
+        }
+        vector<vector<data_t>> X;
+        vector<optional<idx_t>> X_ids;
+        collect_candidates(sources, X, X_ids);
+        for (size_t i = 0; i < X.size(); ++i) {
+            next(X[i], X_ids[i]);
+        }
+        adopt_if_better(other);
+    }
+
+    /**
+     * @brief Returns the best prefix of all sieves (and of the best solution) for every k.
+     *        The acceptance threshold of a sieve depends on K - |S|, so for k < K the
+     *        prefixes have no 1/2 - epsilon guarantee of their own, they are heuristic
+     *        summaries at no extra cost. Use SieveStreamingPP if the guarantee is
+     *        required for every k.
+     */
+    vector<Summary> get_solutions(vector<unsigned int> const& Ks) const override {
+        vector<Summary> summaries;
+        for (auto k : Ks) {
+            check_cardinality(k);
+            summaries.push_back(best_prefix(k, sieves));
+        }
+        return summaries;
+    }
+
+    //返回备选答案集个数
     unsigned int get_num_candidate_solutions() const {
         return sieves.size();
     }
-    //ÿɸд洢Ԫصܸ
+    //返回每个筛子中存储元素的总个数
     unsigned long get_num_elements_stored() const {
         unsigned long num_elements = 0;
         for (auto const& s : sieves) {
-            num_elements += s->get_solution().size();
+            num_elements += s->solution.size();
         }
 
         return num_elements;
     }
 
+    size_t get_memory_bytes() const override {
+        size_t bytes = own_memory();
+        for (auto const& s : sieves) {
+            bytes += sieve_memory(*s);
+        }
+        return bytes;
+    }
+
     /**
      * @brief Destroy the Sieve Streaming object
      *
@@ -203,20 +598,65 @@ public:
     }
 
     /**
-     * @brief ʹеһݡÿɸӼһݵı߼Ƿ񳬹ֵ
-     *        ӽɸӣͱ˵ʹ'get_solution'
-     *        ȡŽ⡣
-     * @param x һݵĳá
+     * @brief 使用数据流中的下一个数据。对每个筛子检查下一个数据的边际增益是否超过阈值，
+     *        如果超过则添加进筛子，否则就被过滤掉（丢弃）。可以使用'get_solution'来获
+     *        取最优解。
+     * @param x 数据流中下一个数据的常引用。
      */
     void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
-        for (auto& s : sieves) {
-            s->next(x, id);//ÿɸԪxбȽ
-            if (s->get_fval() > fval) {//xӽĳɸ
-                fval = s->get_fval();
-                // TODO THIS IS A COPY AT THE MOMENT
-                solution = s->solution;
-                ids = s->ids;//ţԭ߿Ǽ
+        if (is_duplicate(x)) {
+            return;
+        }
+        MetricsScope scope(metrics);
+        MetricTimer timer(MetricEvent::sieve_next);
+        uint64_t start = trace ? trace->now() : 0;
+        uint32_t touched = 0;
+        if (active_dirty) {
+            update_active();
+        }
+        data_t bound = numeric_limits<data_t>::infinity();
+        if (singleton_bound && !active.empty()) {
+            MetricTimer timer(MetricEvent::peek);
+            bound = f->peek({}, x, 0);
+        }
+
+        changed.clear();
+        for (auto i : active) {
+            auto& s = sieves[i];
+            size_t before = s->solution.size();
+            if (s->offer(x, id, bound)) {//每个筛子与新元素x进行比较
+                ++touched;
+                // A query may grow f even if x is rejected, e.g. the scratch row of FastIVM
+                account(*s);
             }
+            if (s->solution.size() > before) {
+                changed.push_back(i);
+                active_dirty |= s->solution.size() == K;
+            }
+        }
+
+        // Only sieves which accepted x can exceed fval. They are checked in the order of
+        // the sieves, so that ties are resolved as if every sieve was checked
+        sort(changed.begin(), changed.end());
+        // The first sieve with the largest value is copied once
+        Sieve const* best = nullptr;
+        for (auto i : changed) {
+            auto& s = sieves[i];
+            if (s->get_fval() > (best ? best->get_fval() : fval)) {//如果x添加进了某个筛子
+                best = s.get();
+            }
+        }
+        if (best) {
+            // TODO THIS IS A COPY AT THE MOMENT
+            adopt(*best);
+        }
+        size_t deleted = 0;
+        if (!changed.empty()) {
+            accepted();
+            deleted = enforce_memory_budget();
+        }
+        if (trace) {
+            trace->record({ start, trace->now() - start, touched, 0, static_cast<uint32_t>(deleted) });
         }
         is_fitted = true;
 
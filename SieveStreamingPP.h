@@ -18,43 +18,43 @@
  *  - Function Types: nonnegative, monotone submodular functions
  *
  * See also:
- *   - Kazemi, E., Mitrovic, M., Zadimoghaddam, M., Lattanzi, S., & Karbasi, A. (2019). Submodular streaming in all its glory: Tight approximation, minimum memory and low adaptive complexity. 36th International Conference on Machine Learning, ICML 2019, 2019-June, 5767C5784. Retrieved from http://proceedings.mlr.press/v97/kazemi19a/kazemi19a.pdf
+ *   - Kazemi, E., Mitrovic, M., Zadimoghaddam, M., Lattanzi, S., & Karbasi, A. (2019). Submodular streaming in all its glory: Tight approximation, minimum memory and low adaptive complexity. 36th International Conference on Machine Learning, ICML 2019, 2019-June, 5767–5784. Retrieved from http://proceedings.mlr.press/v97/kazemi19a/kazemi19a.pdf
 */
 class SieveStreamingPP : public SubmodularOptimizer {
 private:
 
     class Sieve : public SubmodularOptimizer {
     public:
-        // ֵ
+        // 阈值
         data_t threshold;
 
         /**
-         * @brief һµSieve
+         * @brief 创建一个新的Sieve对象
          *
-         * @param K ģŻĻԼҪѡȡԪصĸ
-         * @param f Ӧñ󻯵Ĵģע⵽'clone'һµSubmodularFunction
-                    ӵСҪʵһƵSubmodularFunctionҪȷҪʵ
-                    ܱ¡/
-         * @param threshold ֵ
+         * @param K 次模优化问题的基数约束，要选取元素的个数
+         * @param f 应该被最大化的次模函数。注意到，'clone'函数被用来构造一个新的SubmodularFunction对象
+                    ，被这个对象所拥有。如果要实现一个定制的SubmodularFunction需要确保所有需要的实际上
+                    都能被克隆/复制
+         * @param threshold 阈值
          */
         Sieve(unsigned int K, SubmodularFunction& f, data_t threshold) : SubmodularOptimizer(K, f), threshold(threshold) {}
 
         /**
-         * @brief һµSieve
+         * @brief 创建一个新的Sieve对象
          *
-         * @param K ģŻĻԼҪѡȡԪصĸ
-         * @param f Ӧñ󻯵Ĵģע⵽'clone'һµSubmodularFunction
-                    ӵСҪʵһƵSubmodularFunctionҪȷҪʵ
-                    ܱ¡/
-         * @param threshold ֵ
+         * @param K 次模优化问题的基数约束，要选取元素的个数
+         * @param f 应该被最大化的次模函数。注意到，'clone'函数被用来构造一个新的SubmodularFunction对象
+                    ，被这个对象所拥有。如果要实现一个定制的SubmodularFunction需要确保所有需要的实际上
+                    都能被克隆/复制
+         * @param threshold 阈值
          */
         Sieve(unsigned int K, function<data_t(vector<vector<data_t>> const&)> f, data_t threshold) : SubmodularOptimizer(K, f), threshold(threshold) {
         }
 
        
         /*
-        * @brief ׳쳣Ϊfit()ӦﱻֱӵáSieveԼʹõģ
-                 ͨSieveStreamingpp
+        * @brief 抛出异常，因为fit()函数不应该在这里被直接调用。Sieve对象不是用来自己使用的，而是
+                 通过SieveStreamingpp对象
         */
         void fit(vector<vector<data_t>> const& X, unsigned int iterations = 1) {
             throw runtime_error("Sieves are only meant to be used through SieveStreaming and therefore do not require the implementation of `fit'");
@@ -62,20 +62,29 @@ private:
 
        
         /*
-        * @brief еһݡｫ߼ֵбȽϣֵ
-                 ͽǰԪӵǰ⼯
-        * @param x еǰݵһ
+        * @brief 消耗数据流中的下一个数据。这里将边际增益与阈值进行比较，如果超过了阈值，
+                 就将当前元素添加到当前解集。
+        * @param x 数据流中当前数据的一个常引用
         */
         void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
             unsigned int Kcur = solution.size();
-            if (Kcur < K) {//Լ
-                data_t fdelta = f->peek(solution, x, solution.size()) - fval;//߼
+            if (Kcur < K) {//满足基数约束
+                data_t fdelta;
+                {
+                    // Only gains of at least the threshold matter, so f may reject x early
+                    MetricTimer timer(MetricEvent::peek);
+                    fdelta = f->peek_with_threshold(solution, x, solution.size(), fval + threshold) - fval;
+                }//边际增益
 
                 if (fdelta >= threshold) {
-                    f->update(solution, x, solution.size());
+                    {
+                        MetricTimer timer(MetricEvent::update);
+                        f->update(solution, x, solution.size());
+                    }
                     solution.push_back(x);
                     if (id.has_value()) ids.push_back(id.value());
                     fval += fdelta;
+                    prefix_fvals.push_back(fval);
                 }
             }
             is_fitted = true;
@@ -87,6 +96,38 @@ private:
     data_t m;
     data_t epsilon;
 
+    // The smallest sampling probability of the stream, see set_sampling_probability()
+    data_t sampling = 1;
+
+    // The smallest threshold for the current lower bound of OPT
+    inline data_t min_threshold() const {
+        return max(lower_bound, m * sampling) / static_cast<data_t>(2.0 * K);
+    }
+
+    // Per-element latency trace, see enable_tracing()
+    unique_ptr<LatencyTrace> trace;
+
+    // Use the singleton value of every element to skip sieves, see enable_singleton_bound()
+    bool singleton_bound = true;
+
+    // The indices of all sieves which are not full yet, sorted by threshold
+    vector<size_t> active;
+    bool active_dirty = true;
+
+    // The indices of the sieves which accepted the current element
+    vector<size_t> changed;
+
+    void update_active() {
+        active.clear();
+        for (size_t i = 0; i < sieves.size(); ++i) {
+            if (sieves[i]->solution.size() < K) active.push_back(i);
+        }
+        stable_sort(active.begin(), active.end(),
+            [this](size_t a, size_t b) { return sieves[a]->threshold < sieves[b]->threshold; }
+        );
+        active_dirty = false;
+    }
+
 public:
     vector<unique_ptr<Sieve>> sieves;
 
@@ -108,6 +149,171 @@ public:
         // }
     }
 
+    /**
+     * @brief  Starts recording the duration of every call of next() together with the
+            number of sieves touched, created and deleted. Only the last `capacity'
+            calls are kept, see LatencyTrace. Tracing is off by default.
+     * @param  capacity: The size of the ring buffer.
+     */
+    void enable_tracing(size_t capacity = 65536) {
+        trace.reset(new LatencyTrace(capacity));
+    }
+
+    // The recorded trace or nullptr if tracing was not enabled
+    LatencyTrace const* get_trace() const {
+        return trace.get();
+    }
+
+    /**
+     * @brief  The smallest threshold is max(fval, m) / (2K), but OPT of a stream which is
+            sampled with probability p can be about p * OPT and thus fall below m. Hence,
+            m * p replaces m. The new sieves are seeded with the elements stored so far
+            (the best solution and all sieves, as in merge()) and see all following elements.
+     * @param  p: The smallest sampling probability in (0, 1].
+     */
+    void set_sampling_probability(data_t p) override {
+        if (!(p > 0 && p <= 1)) {
+            throw runtime_error("SieveStreamingPP::set_sampling_probability: The probability must be in (0, 1].");
+        }
+        if (p >= sampling) {
+            return;
+        }
+        sampling = p;
+        if (sieves.empty()) {
+            // next() creates the first sieves from the new bound
+            return;
+        }
+
+        vector<SubmodularOptimizer const*> sources = { this };
+        for (auto const& s : sieves) {
+            sources.push_back(s.get());
+        }
+        vector<vector<data_t>> X;
+        vector<optional<idx_t>> X_ids;
+        collect_candidates(sources, X, X_ids);
+
+        for (auto t : thresholds(min_threshold() / (1.0 + epsilon), K * m, epsilon)) {
+            bool any = any_of(sieves.begin(), sieves.end(),
+                [t](auto const& s) { return s->threshold == t; }
+            );
+            if (!any) {
+                auto s = make_unique<Sieve>(K, *f, t);
+                for (size_t i = 0; i < X.size(); ++i) {
+                    s->next(X[i], X_ids[i]);
+                }
+                if (s->get_fval() > fval) {
+                    adopt(*s);
+                }
+                sieves.push_back(move(s));
+                active_dirty = true;
+            }
+        }
+    }
+
+    // The smallest sampling probability the thresholds cover, see set_sampling_probability()
+    inline data_t get_sampling_probability() const {
+        return sampling;
+    }
+
+    /**
+     * @brief  For a submodular f with f(empty set) = 0 the singleton value f({x}) bounds the
+            gain of x for every solution. A sieve only accepts gains of at least its
+            threshold, so with the bound enabled every element costs one extra query
+            f({x}) and a binary search over the thresholds of the sieves which are not
+            full yet. Only sieves with a threshold up to f({x}) are queried. The solutions
+            are the same as without the bound. Enabled by default.
+     * @param  enable: true to use the bound.
+     */
+    void enable_singleton_bound(bool enable = true) {
+        singleton_bound = enable;
+    }
+
+    /**
+     * @brief Writes the state of all sieves. An incremental checkpoint contains the elements
+     *        each sieve has accepted since the last checkpoint; sieves which were created
+     *        since then are written in full and deleted sieves are simply missing.
+     */
+    void save(BinaryWriter& out, bool incremental = false) override {
+        save_state(out, 0);
+        out.write<data_t>(lower_bound);
+        out.write<data_t>(sampling);
+        out.write<uint64_t>(sieves.size());
+        for (auto& s : sieves) {
+            out.write<data_t>(s->threshold);
+            s->save(out, incremental);
+        }
+    }
+
+    void load(BinaryReader& in) override {
+        load_state(in);
+        lower_bound = in.read<data_t>();
+        sampling = in.read<data_t>();
+        size_t num_sieves = in.read<uint64_t>();
+
+        // Thresholds are unique, so sieves are matched by their threshold
+        vector<unique_ptr<Sieve>> restored;
+        for (size_t i = 0; i < num_sieves; ++i) {
+            data_t t = in.read<data_t>();
+            auto it = find_if(sieves.begin(), sieves.end(),
+                [t](auto const& s) { return s && s->threshold == t; }
+            );
+            if (it != sieves.end()) {
+                restored.push_back(move(*it));
+            }
+            else {
+                restored.push_back(make_unique<Sieve>(K, *f, t));
+            }
+            restored.back()->load(in);
+        }
+        sieves = move(restored);
+        active_dirty = true;
+    }
+
+    /**
+     * @brief Merges the summary of another SieveStreamingPP, e.g. of another shard of the
+     *        same stream, into this one. The distinct elements stored by other are streamed
+     *        through next() and the best solution of other is taken over if it is better,
+     *        see SieveStreaming::merge for the guarantee. A better solution of other also
+     *        raises the lower bound, so that sieves with too small thresholds are removed
+     *        by the next call of next().
+     * @param other The optimizer to merge, it is not changed. Must have the same K, m and epsilon.
+     */
+    void merge(SieveStreamingPP const& other) {
+        check_mergeable(other);
+        // The guarantee relies on the same grid of OPT guesses in all shards
+        if (other.m != m || other.epsilon != epsilon) {
+            throw runtime_error("SieveStreamingPP::merge: Both optimizers must have the same m and epsilon (m = " + to_string(m) + " vs. " + to_string(other.m) + ", epsilon = " + to_string(epsilon) + " vs. " + to_string(other.epsilon) + ").");
+        }
+        vector<SubmodularOptimizer const*> sources = { &other };
+        for (auto const& s : other.sieves) {
+            sources.push_back(s.get());
+        }
+        vector<vector<data_t>> X;
+        vector<optional<idx_t>> X_ids;
+        collect_candidates(sources, X, X_ids);
+        for (size_t i = 0; i < X.size(); ++i) {
+            next(X[i], X_ids[i]);
+        }
+        adopt_if_better(other);
+    }
+
+    /**
+     * @brief Returns the best prefix of all sieves (and of the best solution) for every k.
+     *        Every element of a sieve with threshold tau has a gain of at least tau, so
+     *        the first k elements have a value of at least k * tau. For the sieve with
+     *        tau close to OPT_k / (2k), which exists since tau_min <= OPT_k / (2k), either
+     *        this prefix or the entire (smaller) sieve has a value of at least
+     *        (1/2 - epsilon) OPT_k. Hence, the guarantee holds for every k <= K.
+     */
+    vector<Summary> get_solutions(vector<unsigned int> const& Ks) const override {
+        vector<Summary> summaries;
+        for (auto k : Ks) {
+            check_cardinality(k);
+            summaries.push_back(best_prefix(k, sieves));
+        }
+        return summaries;
+    }
+
     unsigned int get_num_candidate_solutions() const {
         return sieves.size();
     }
@@ -115,22 +321,41 @@ public:
     unsigned long get_num_elements_stored() const {
         unsigned long num_elements = 0;
         for (auto const& s : sieves) {
-            num_elements += s->get_solution().size();
+            // Sieves which were never queried are not fitted, but empty
+            num_elements += s->solution.size();
         }
 
         return num_elements;
     }
 
+    // Sieves below the lower bound are deleted anyway, so the memory adapts to fval on its own
+    size_t get_memory_bytes() const override {
+        size_t bytes = SubmodularOptimizer::get_memory_bytes() - sizeof(SubmodularOptimizer) + sizeof(SieveStreamingPP)
+            + sieves.capacity() * sizeof(unique_ptr<Sieve>) + (active.capacity() + changed.capacity()) * sizeof(size_t);
+        for (auto const& s : sieves) {
+            bytes += s->get_memory_bytes() - sizeof(SubmodularOptimizer) + sizeof(Sieve);
+        }
+        return bytes;
+    }
+
     void next(vector<data_t> const& x, optional<idx_t> const id = nullopt) {
+        if (is_duplicate(x)) {
+            return;
+        }
+        MetricsScope scope(metrics);
+        uint64_t start = trace ? trace->now() : 0;
+        uint32_t created = 0, deleted = 0;
         if (lower_bound != fval || sieves.size() == 0) {
             lower_bound = fval;
-            data_t tau_min = max(lower_bound, m) / static_cast<data_t>(2.0 * K);//Сֵ
+            data_t tau_min = min_threshold();//更新最小阈值
             auto no_sieves_before = sieves.size();
 
             auto res = remove_if(sieves.begin(), sieves.end(),
-                [tau_min](auto const& s) { return s->threshold < tau_min; }//ɾССֵɸ
+                [tau_min](auto const& s) { return s->threshold < tau_min; }//删除小于最小阈值的筛子
             );
             sieves.erase(res, sieves.end());
+            deleted = no_sieves_before - sieves.size();
+            active_dirty |= deleted > 0;
 
             if (no_sieves_before > sieves.size() || no_sieves_before == 0) {
                 vector<data_t> ts = thresholds(tau_min / (1.0 + epsilon), K * m, epsilon);
@@ -141,21 +366,66 @@ public:
                     );
                     if (!any) {
                         sieves.push_back(make_unique<Sieve>(K, *f, t));
+                        ++created;
+                        active_dirty = true;
                     }
                 }
             }
         }
 
         // std::cout << sieves.size() << std::endl;
-        for (auto& s : sieves) {
+        MetricTimer timer(MetricEvent::sieve_next);
+        uint32_t touched = 0;
+        if (active_dirty) {
+            update_active();
+        }
+        auto last = active.end();
+        if (singleton_bound && !active.empty()) {
+            data_t bound;
+            {
+                MetricTimer timer(MetricEvent::peek);
+                bound = f->peek({}, x, 0);
+            }
+            // fval is at least the value of every sieve, so the slack covers all of them
+            bound += SieveStreaming::BOUND_SLACK * (abs(bound) + abs(fval));
+            last = upper_bound(active.begin(), active.end(), bound,
+                [this](data_t b, size_t i) { return b < sieves[i]->threshold; }
+            );
+        }
+
+        changed.clear();
+        for (auto it = active.begin(); it != last; ++it) {
+            auto& s = sieves[*it];
+            size_t before = s->solution.size();
+            ++touched;
             s->next(x, id);
-            if (s->get_fval() > fval) {
-                fval = s->get_fval();
-                // TODO THIS IS A COPY AT THE MOMENT
-                solution = s->solution;
-                ids = s->ids;//ţǼ
+            if (s->solution.size() > before) {
+                changed.push_back(*it);
+                active_dirty |= s->solution.size() == K;
+            }
+        }
+
+        // Only sieves which accepted x can exceed fval. They are checked in the order of
+        // the sieves, so that ties are resolved as if every sieve was checked
+        sort(changed.begin(), changed.end());
+        // The first sieve with the largest value is copied once
+        Sieve const* best = nullptr;
+        for (auto i : changed) {
+            auto& s = sieves[i];
+            if (s->get_fval() > (best ? best->get_fval() : fval)) {
+                best = s.get();
             }
         }
+        if (best) {
+            // TODO THIS IS A COPY AT THE MOMENT
+            adopt(*best);
+        }
+        if (!changed.empty()) {
+            accepted();
+        }
+        if (trace) {
+            trace->record({ start, trace->now() - start, touched, created, deleted });
+        }
         is_fitted = true;
     };
 };
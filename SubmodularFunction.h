@@ -7,16 +7,90 @@
 #include <vector>
 #include <functional>
 #include <cassert>
+#include <algorithm>
 
 #include "DataTypeHandling.h"
+#include "Serialization.h"
 
 using namespace std;
 
+/**
+ * @brief  A non-owning view of "the current solution with x at position pos", that is
+        cur_solution with x appended (pos >= cur_solution.size()) or with the element
+        at pos replaced by x. It lets functions evaluate a candidate solution in peek
+        without copying the stored rows. The view must not outlive cur_solution and x.
+ */
+class SolutionView {
+private:
+    vector<vector<data_t>> const* solution;
+    vector<data_t> const* x;
+    size_t pos;
+    size_t n;
+
+public:
+    class const_iterator {
+    private:
+        SolutionView const* view;
+        size_t i;
+
+    public:
+        const_iterator(SolutionView const* view, size_t i) : view(view), i(i) {}
+        inline vector<data_t> const& operator*() const { return (*view)[i]; }
+        inline vector<data_t> const* operator->() const { return &(*view)[i]; }
+        inline const_iterator& operator++() { ++i; return *this; }
+        inline bool operator==(const_iterator const& other) const { return i == other.i; }
+        inline bool operator!=(const_iterator const& other) const { return i != other.i; }
+    };
+
+    // The solution itself
+    explicit SolutionView(vector<vector<data_t>> const& solution)
+        : solution(&solution), x(nullptr), pos(solution.size()), n(solution.size()) {}
+
+    // The solution with x at position pos
+    SolutionView(vector<vector<data_t>> const& solution, vector<data_t> const& x, unsigned int pos)
+        : solution(&solution), x(&x), pos(min<size_t>(pos, solution.size())),
+        n(pos >= solution.size() ? solution.size() + 1 : solution.size()) {}
+
+    inline size_t size() const { return n; }
+
+    inline bool empty() const { return n == 0; }
+
+    inline vector<data_t> const& operator[](size_t i) const {
+        return x != nullptr && i == pos ? *x : (*solution)[i];
+    }
+
+    inline const_iterator begin() const { return const_iterator(this, 0); }
+
+    inline const_iterator end() const { return const_iterator(this, n); }
+
+    /**
+     * @brief  Copies the viewed solution into out. The rows of out are re-used, so
+            repeated calls with the same out do not allocate once its capacity suffices.
+     */
+    void copy_to(vector<vector<data_t>>& out) const {
+        out.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            out[i].assign((*this)[i].begin(), (*this)[i].end());
+        }
+    }
+};
+
+/**
+ * @brief  The heap memory held by a set of rows (including the row headers), in bytes.
+ */
+inline size_t memory_bytes(vector<vector<data_t>> const& rows) {
+    size_t bytes = rows.capacity() * sizeof(vector<data_t>);
+    for (auto const& row : rows) {
+        bytes += row.capacity() * sizeof(data_t);
+    }
+    return bytes;
+}
+
 /*
-* ÿģӦʵֵĽӿࡣеŻҪ
-* ӿṩһݵķʽʵ״̬Ĵģÿģṩĸ
-* operater(),peek,update,cloneSubmodularOptimizersۺʱһֵʱ'peek'
-* ۺʱһԪ⼯ʱ'update'
+* 每个次模函数应该实现的接口类。所有的优化器都需要。
+* 这个接口提供了一个便捷的方式来实现有状态的次模函数。每个次模函数都必须提供四个函数：
+* operater(),peek,update,clone。SubmodularOptimizers无论何时请求一个函数值时调用'peek'
+* 函数，无论何时一个新元素添加至解集时调用'update'函数。
 */
 class SubmodularFunction {
 public:
@@ -24,23 +98,42 @@ public:
     virtual data_t operator()(vector<vector<data_t>> const& cur_solution) const = 0;
 
      /*
-     * @brief xڵǰλposӽĻغֵ
-     *        posȵǰеԪظĻxӽǰ⡣x滻posԪء    
-     * @param cur_solution: ǰ
-     * @param x: ҪӽԪ
-     * @param pos: Ҫӽxλá0 <= pos < K
-     * @retval xӽǰposĺֵ
+     * @brief 如果x会在当前解的位置pos被添加进解的话，返回函数值。
+     *        如果pos比当前解中的元素个数多的话，将x添加进当前解。否则，用x替换pos处的元素。    
+     * @param cur_solution: 当前解
+     * @param x: 假设要添加进解的元素
+     * @param pos: 要添加进x的位置。0 <= pos < K
+     * @retval 将x添加进当前解的pos处的函数值
      */
     virtual data_t peek(vector<vector<data_t>> const& cur_solution,
         vector<data_t> const& x, unsigned int pos) = 0;
 
     /**
-     * @brief  "pos"xǰĻºposȵǰеԪشĻxӽ
-     *         ǰ⡣򣬽posĽx滻
+     * @brief  Like peek, but the caller is only interested in the exact function value
+               if it is at least `threshold', e.g. a sieve which only accepts x if its
+               gain exceeds the sieve's threshold. Functions which can cheaply bound the
+               function value may stop early once the bound shows that the value is below
+               threshold, and then return some value which is smaller than threshold.
+               The default computes the exact value with peek.
+     * @note   Whenever the exact value is >= threshold, it is returned.
+     * @param  cur_solution: The current solution.
+     * @param  x: The element which would be added.
+     * @param  pos: The position of x, 0 <= pos < K.
+     * @param  threshold: The function value the caller is interested in.
+     * @retval The function value, or a value < threshold if it is below threshold.
+     */
+    virtual data_t peek_with_threshold(vector<vector<data_t>> const& cur_solution,
+        vector<data_t> const& x, unsigned int pos, data_t threshold) {
+        return peek(cur_solution, x, pos);
+    }
+
+    /**
+     * @brief  如果将"pos"处增加x到当前解的话更新函数。如果pos比当前解中的元素大的话，将x添加进
+     *         当前解。否则，将pos处的解与x进行替换。
      * @note
-     * @param  cur_solution: ǰ.
-     * @param  x: Ҫӽ⼯Ԫ.
-     * @param  pos: xλãע⵽ΧΪ 0 <= pos < K
+     * @param  cur_solution: 当前解.
+     * @param  x: 将要添加进解集的元素.
+     * @param  pos: 添加x的位置，注意到范围为 0 <= pos < K
      * @retval None
      */
     virtual void update(vector<vector<data_t>> const& cur_solution,
@@ -59,6 +152,42 @@ public:
      */
     virtual shared_ptr<SubmodularFunction> clone() const = 0;
 
+    /**
+     * @brief  Writes the internal state of this function which belongs to the elements
+               at positions >= from of the current solution. from = 0 writes the entire
+               state, from > 0 writes an incremental checkpoint on top of a state which
+               already covers the first `from' elements. Stateless functions write
+               nothing, which is the default.
+     * @note   The configuration (kernel, sigma, K, ...) is not written. load() expects
+               an object which was constructed with the same parameters.
+     * @param  out: The output.
+     * @param  from: Number of elements which are already contained in the checkpoint.
+     * @retval None
+     */
+    virtual void save(BinaryWriter& out, unsigned int from = 0) const {}
+
+    /**
+     * @brief  Restores the state written by save(out, from). The first `from' elements
+               of this function's state are kept, everything after them is replaced.
+     * @note
+     * @param  in: The input.
+     * @param  from: The value which was passed to save().
+     * @retval None
+     */
+    virtual void load(BinaryReader& in, unsigned int from = 0) {}
+
+    /**
+     * @brief  The memory of the state of this function in bytes, i.e. the object itself
+               and everything it owns. Data which is shared between all clones (e.g. the
+               ground set of FacilityLocation) is not counted, since it does not grow
+               with the number of clones. Defaults to the size of the base class, which
+               fits stateless functions.
+     * @retval The number of bytes.
+     */
+    virtual size_t get_memory_bytes() const {
+        return sizeof(*this);
+    }
+
     /**
      * @brief  Destroys this object
      * @note
@@ -81,6 +210,10 @@ public:
         for stateful functions. If your submodular function requires some internal
         states which e.g. depend on the order of items added please consider to
         implement a `proper' SubmodularFunction.
+        A std::function over a SolutionView is evaluated on the candidate solution in
+        peek without any copy. A std::function over vector<vector<data_t>> needs the
+        candidate solution as a vector, which is then copied into a buffer that is
+        re-used between calls.
  * @note
  * @retval None
  */
@@ -89,6 +222,12 @@ protected:
     // The std::function which implements the actual submodular function
     function<data_t(vector<vector<data_t>> const&)> f;
 
+    // Alternatively, a std::function which works on a SolutionView
+    function<data_t(SolutionView const&)> f_view;
+
+    // Buffer for the candidate solution if f needs it as a vector
+    vector<vector<data_t>> tmp;
+
 public:
 
     /**
@@ -101,6 +240,16 @@ public:
     SubmodularFunctionWrapper(function<data_t(vector<vector<data_t>>
         const&)> f) : f(f) {}
 
+    /**
+     * @brief  Creates a new SubmodularFunction from a std::function object which
+            works on a SolutionView, so that peek does not copy any rows.
+     * @note
+     * @param  f_view: The (stateless) function which implements the actual submodular
+            function
+     * @retval
+     */
+    SubmodularFunctionWrapper(function<data_t(SolutionView const&)> f_view) : f_view(f_view) {}
+
     /**
      * @brief  Implements the () operator by simply delegating the call to the
             underlying std::function.
@@ -109,14 +258,17 @@ public:
      * @retval
      */
     data_t operator()(vector<vector<data_t>> const& cur_solution) const {
+        if (f_view) {
+            return f_view(SolutionView(cur_solution));
+        }
         return f(cur_solution);
     }
 
     /**
-     * @brief  Implements the peek method. This copies the current solution vector to
-            a new one, adds x at the appropriate positon and calls the ()-operator.
-            In most cases the copy is probably not necessary (e.g. if we only append
-            x to the current solution) which makes this code slightly inefficient.
+     * @brief  Implements the peek method. A SolutionView function is called on a view
+            of the current solution with x at the appropriate position. Otherwise the
+            candidate solution is copied into a buffer whose rows are re-used between
+            calls, so that peek does not allocate once the buffer has grown to K rows.
      * @note
      * @param  &cur_solution:
      * @param  &x:
@@ -125,16 +277,12 @@ public:
      */
     data_t peek(vector<vector<data_t>> const& cur_solution,
         vector<data_t> const& x, unsigned int pos) {
-        vector<vector<data_t>> tmp(cur_solution);
-
-        if (pos >= cur_solution.size()) {
-            tmp.push_back(x);
-        }
-        else {
-            tmp[pos] = x;
+        SolutionView view(cur_solution, x, pos);
+        if (f_view) {
+            return f_view(view);
         }
-        data_t ftmp = this->operator()(tmp);
-        return ftmp;
+        view.copy_to(tmp);
+        return f(tmp);
     }
 
     /**
@@ -162,6 +310,9 @@ public:
      * @retval
      */
     shared_ptr<SubmodularFunction> clone() const {
+        if (f_view) {
+            return shared_ptr<SubmodularFunction>(new SubmodularFunctionWrapper(f_view));
+        }
         return shared_ptr<SubmodularFunction>(new SubmodularFunctionWrapper(f));
     }
 
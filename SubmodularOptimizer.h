@@ -3,16 +3,39 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 #include <functional>
 #include <cassert>
 #include <memory>
 #include <optional>
+#include <algorithm>
+#include <unordered_map>
 
 #include "SubmodularFunction.h"
+#include "Dataset.h"
+#include "DataSource.h"
+#include "Metrics.h"
+#include "Serialization.h"
+#include "DuplicateFilter.h"
+#include "RowHash.h"
 
 using namespace std;
+
+/**
+ * @brief  A solution of (at most) K elements with its ids and function value, see
+        SubmodularOptimizer::get_solutions() and SubmodularOptimizer::get_snapshot().
+ */
+struct Summary {
+    unsigned int K;
+    vector<vector<data_t>> solution;
+    vector<idx_t> ids;
+    data_t fval;
+    // Snapshots are numbered 1, 2, ... in the order they were published, 0 otherwise
+    uint64_t epoch = 0;
+};
+
 /**
  * @brief  Interface class which every optimizer should implement. Each optimizer
         must offer a next() and fit() function. However, if a certain optimizer does
@@ -63,6 +86,216 @@ protected:
     // true if fit() or next() has been called.
     bool is_fitted;
 
+    // Instrumentation counters, see Metrics.h. Only recorded if SUBMODULAR_METRICS is defined.
+    OptimizerMetrics metrics;
+
+    // Number of elements of `solution' which are contained in the last checkpoint
+    size_t checkpointed = 0;
+
+    // Drops duplicate elements before f is queried, see enable_duplicate_filter()
+    unique_ptr<DuplicateFilter> duplicates;
+
+    // The last published snapshot, see enable_snapshots(). Only accessed through
+    // atomic_load / atomic_store, because readers run on other threads
+    shared_ptr<Summary const> snapshot;
+    bool snapshots = false;
+    uint64_t snapshot_epoch = 0;
+
+    // Numbers and publishes a snapshot which was built by the caller, i.e. a single pointer store
+    void publish_snapshot(shared_ptr<Summary> s) {
+        s->epoch = ++snapshot_epoch;
+        atomic_store_explicit(&snapshot, shared_ptr<Summary const>(move(s)), memory_order_release);
+    }
+
+    /**
+     * @brief  Publishes a copy of the current solution, ids and fval for get_snapshot()
+            if snapshots are enabled. Optimizers which change `solution' in place (e.g.
+            Random) call it whenever their solution changed, i.e. once per accepted
+            element and not once per element. Optimizers whose best solution is a copy
+            of another one use adopt() instead.
+     */
+    void publish_snapshot() {
+        if (!snapshots) return;
+        publish_snapshot(make_shared<Summary>(Summary{ K, solution, ids, fval }));
+    }
+
+    /**
+     * @brief  Takes over the solution of `source' (e.g. the best sieve) as the best solution.
+            With snapshots enabled, the snapshot is built from `source' while copying,
+            so an improvement costs one copy for the snapshot and one pointer store.
+     */
+    void adopt(SubmodularOptimizer const& source) {
+        shared_ptr<Summary> s;
+        if (snapshots) {
+            s = make_shared<Summary>(Summary{ K, source.solution, source.ids, source.fval });
+        }
+        count_metric(MetricEvent::solution_copy);
+        solution = source.solution;
+        ids = source.ids;
+        prefix_fvals = source.prefix_fvals;
+        fval = source.fval;
+        is_fitted = true;
+        if (s) {
+            publish_snapshot(move(s));
+        }
+    }
+
+    // The first (at most) k elements of the solution
+    Summary prefix(unsigned int k) const {
+        size_t n = min<size_t>(k, solution.size());
+        Summary s;
+        s.K = k;
+        s.solution.assign(solution.begin(), solution.begin() + n);
+        s.ids.assign(ids.begin(), ids.begin() + min(n, ids.size()));
+        s.fval = n > 0 ? prefix_fvals[n - 1] : 0;
+        return s;
+    }
+
+    // The first k elements of the solution of this optimizer or of one of the candidates
+    // (e.g. the sieves), whichever has the largest function value
+    template <typename Candidates>
+    Summary best_prefix(unsigned int k, Candidates const& candidates) const {
+        SubmodularOptimizer const* best = this;
+        data_t best_fval = prefix(k).fval;
+        for (auto const& c : candidates) {
+            SubmodularOptimizer const& opt = *c;
+            size_t n = min<size_t>(k, opt.solution.size());
+            if (n > 0 && opt.prefix_fvals[n - 1] > best_fval) {
+                best = &opt;
+                best_fval = opt.prefix_fvals[n - 1];
+            }
+        }
+        return best->prefix(k);
+    }
+
+    /**
+     * @brief  Collects the distinct elements of the solutions of `sources' (e.g. an optimizer
+            and all of its sieves) in this order, see merge(). Ids are only kept for
+            solutions which have an id for every element.
+     * @param  sources: The optimizers.
+     * @param  X: The distinct elements.
+     * @param  X_ids: Their ids.
+     */
+    static void collect_candidates(vector<SubmodularOptimizer const*> const& sources, vector<vector<data_t>>& X, vector<optional<idx_t>>& X_ids) {
+        unordered_multimap<uint64_t, size_t> index;
+        for (auto opt : sources) {
+            bool with_ids = opt->ids.size() == opt->solution.size();
+            for (size_t i = 0; i < opt->solution.size(); ++i) {
+                auto const& x = opt->solution[i];
+                uint64_t h = hash_row(x);
+                auto range = index.equal_range(h);
+                if (any_of(range.first, range.second, [&](auto const& e) { return X[e.second] == x; })) {
+                    continue;
+                }
+                index.insert({ h, X.size() });
+                X.push_back(x);
+                X_ids.push_back(with_ids ? optional<idx_t>(opt->ids[i]) : nullopt);
+            }
+        }
+    }
+
+    // Takes over the best solution of other if it is better than the own one, see merge()
+    void adopt_if_better(SubmodularOptimizer const& other) {
+        if (other.is_fitted && (!is_fitted || other.fval > fval)) {
+            adopt(other);
+        }
+    }
+
+    // Throws if other cannot be merged into this optimizer
+    void check_mergeable(SubmodularOptimizer const& other) const {
+        if (&other == this) {
+            throw runtime_error("merge: An optimizer cannot be merged with itself.");
+        }
+        if (other.K != K) {
+            throw runtime_error("merge: Both optimizers must have the same K (" + to_string(K) + " vs. " + to_string(other.K) + ").");
+        }
+    }
+
+    // Throws if k is no valid cardinality for get_solutions()
+    void check_cardinality(unsigned int k) const {
+        if (!is_fitted) {
+            throw runtime_error("Optimizer was not fitted yet! Please call fit() or next() before calling get_solutions()");
+        }
+        if (k > K) {
+            throw runtime_error("get_solutions: Every K must be at most the K of the optimizer (" + to_string(K) + "), but got " + to_string(k) + ".");
+        }
+    }
+
+    // true if x should be skipped by next() because it is a duplicate
+    inline bool is_duplicate(vector<data_t> const& x) {
+        return duplicates && duplicates->check(x);
+    }
+
+    // Tells the duplicate filter that the element of the last is_duplicate() call was accepted
+    inline void accepted() {
+        if (duplicates) duplicates->accept();
+    }
+
+    /**
+     * @brief  Writes K, fval, the elements solution[from], ..., solution.back(), the
+            new ids and the state of f which belongs to them. A restored optimizer
+            keeps its first `from' elements, so from = 0 writes a full snapshot.
+     * @note   Only valid if the first `from' elements did not change since they were
+            written, i.e. if the optimizer only appends to its solution.
+     * @param  out: The output.
+     * @param  from: Number of elements which are already contained in the checkpoint.
+     * @retval None
+     */
+    void save_state(BinaryWriter& out, size_t from) {
+        out.write<uint32_t>(K);
+        out.write<uint8_t>(is_fitted);
+        out.write<data_t>(fval);
+        out.write<uint64_t>(from);
+        out.write<uint64_t>(solution.size());
+        for (size_t i = from; i < solution.size(); ++i) {
+            out.write_vector(solution[i]);
+        }
+        out.write<uint64_t>(ids.size());
+        for (size_t i = min(from, ids.size()); i < ids.size(); ++i) {
+            out.write<idx_t>(ids[i]);
+        }
+        out.write<uint64_t>(prefix_fvals.size());
+        for (size_t i = min(from, prefix_fvals.size()); i < prefix_fvals.size(); ++i) {
+            out.write<data_t>(prefix_fvals[i]);
+        }
+        f->save(out, from);
+        checkpointed = solution.size();
+    }
+
+    /**
+     * @brief  Restores what save_state() has written.
+     * @note
+     * @param  in: The input.
+     * @retval None
+     */
+    void load_state(BinaryReader& in) {
+        K = in.read<uint32_t>();
+        is_fitted = in.read<uint8_t>() != 0;
+        fval = in.read<data_t>();
+        size_t from = in.read<uint64_t>();
+        if (from > solution.size()) {
+            throw runtime_error("SubmodularOptimizer::load: The checkpoint is incremental, but this optimizer does not hold the elements it is based on.");
+        }
+        size_t num_elements = in.read<uint64_t>();
+        solution.resize(from);
+        while (solution.size() < num_elements) {
+            solution.push_back(in.read_vector<data_t>());
+        }
+        size_t num_ids = in.read<uint64_t>();
+        ids.resize(min(from, min(ids.size(), num_ids)));
+        while (ids.size() < num_ids) {
+            ids.push_back(in.read<idx_t>());
+        }
+        size_t num_fvals = in.read<uint64_t>();
+        prefix_fvals.resize(min(from, min(prefix_fvals.size(), num_fvals)));
+        while (prefix_fvals.size() < num_fvals) {
+            prefix_fvals.push_back(in.read<data_t>());
+        }
+        f->load(in, from);
+        checkpointed = solution.size();
+        publish_snapshot();
+    }
+
 public:
     // The current solution of this optimizer
     vector<vector<data_t>> solution;
@@ -71,6 +304,10 @@ public:
     // The current function value of this optimizer
     data_t fval;
 
+    // prefix_fvals[i] is the function value of solution[0], ..., solution[i]. Only kept by
+    // optimizers which build their solution by appending, see get_solutions()
+    vector<data_t> prefix_fvals;
+
     /**
      * @brief  Creates a submodular optimizer object.
      * @note
@@ -167,6 +404,64 @@ public:
         }
     }
 
+    /**
+     * @brief  Find a solution given the entire data set as a contiguous view, e.g. a
+            memory-mapped binary data set. Rows are not copied up-front, every row is
+            staged into one re-used buffer right before it is passed to next(). See
+            fit(vector<vector<data_t>> const&, vector<idx_t> const&, unsigned int) for
+            the meaning of the parameters.
+     * @note
+     * @param  X: A view of the entire data set
+     * @param  ids: The ids of the rows in X
+     * @param  iterations: Maximum number of iterations over the entire data-set
+     * @retval None
+     */
+    virtual void fit(DatasetView const& X, vector<idx_t> const& ids, unsigned int iterations = 1) {
+        assert(X.size() == ids.size());
+        vector<data_t> x;
+
+        for (unsigned int i = 0; i < iterations; ++i) {
+            for (size_t j = 0; j < X.size(); ++j) {
+                x.assign(X.row(j), X.row(j) + X.dimension());
+                next(x, ids[j]);
+                if (solution.size() == K && i > 0) {
+                    return;
+                }
+            }
+        }
+    }
+
+    virtual void fit(DatasetView const& X, unsigned int iterations = 1) {
+        vector<data_t> x;
+
+        for (unsigned int i = 0; i < iterations; ++i) {
+            for (size_t j = 0; j < X.size(); ++j) {
+                x.assign(X.row(j), X.row(j) + X.dimension());
+                next(x);
+                if (solution.size() == K && i > 0) {
+                    return;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief  Consume an entire (possibly unbounded) stream element by element. Only
+            the current element is held in memory, so the memory consumption is that
+            of the optimizer itself plus whatever `source' buffers. Wrap the source in
+            a PrefetchingDataSource to overlap parsing / I/O with the optimization.
+     * @note
+     * @param  source: The stream to be consumed.
+     * @retval None
+     */
+    virtual void fit(DataSource& source) {
+        vector<data_t> x;
+        idx_t id;
+        while (source.next(x, id)) {
+            next(x, id);
+        }
+    }
+
     /**
      * @brief  Consume the next object in the data stream. This may throw an 
             exception if the optimizer does not support streaming.
@@ -177,6 +472,18 @@ public:
     virtual void next(vector<data_t> const& x, 
         optional<idx_t> const id = nullopt) = 0;
 
+    /**
+     * @brief  Tells a streaming optimizer that from now on every element of the stream is
+            only passed to next() with probability at least p, e.g. by the load shedding
+            of ConcurrentIngestor. OPT of such a sample can be as small as about p * OPT,
+            so optimizers which guess OPT from a given bound (e.g. the threshold grid of
+            SieveStreaming) extend their guesses accordingly. p only decreases over
+            the calls. The default does nothing.
+     * @param  p: The smallest sampling probability in (0, 1].
+     * @retval None
+     */
+    virtual void set_sampling_probability(data_t p) {}
+
 
     /**
      * @brief  Return the current solution.
@@ -201,6 +508,64 @@ public:
         }
     }
 
+    /**
+     * @brief  Returns a solution for each of the given cardinalities, all from the
+            single run to K. Optimizers which build their solution by appending
+            (Greedy, FastGreedyMAP) return the first k elements of their solution.
+            These are exactly the solutions a run with K = k would return, because
+            the greedy choice does not depend on K. The sieve optimizers return the
+            best prefix of all sieves, see SieveStreaming and SieveStreamingPP.
+            Optimizers which replace elements (Random) throw an exception.
+     * @note   Costs O(sum(Ks) * D) for copying the elements, no function queries are made.
+     * @param  Ks: The cardinalities, each at most K.
+     * @retval One Summary per entry of Ks, in the same order.
+     */
+    virtual vector<Summary> get_solutions(vector<unsigned int> const& Ks) const {
+        vector<Summary> summaries;
+        for (auto k : Ks) {
+            check_cardinality(k);
+            summaries.push_back(prefix(k));
+        }
+        return summaries;
+    }
+
+    /**
+     * @brief  Lets other threads read the solution while this optimizer consumes a stream,
+            e.g. a query service while a ConcurrentIngestor feeds the optimizer. The
+            getters get_solution(), get_ids() and get_fval() return the live state,
+            which next() changes in place. With snapshots enabled, the optimizer
+            additionally publishes an immutable copy of its solution whenever it
+            improves, which get_snapshot() hands out without waiting for next().
+     * @note   Call it before other threads read snapshots. The snapshot is built while
+            the new solution is copied (see adopt()), so an improvement costs one copy
+            of the K elements and one pointer store. Elements which do not change the
+            solution cost nothing.
+     * @param  enable: true publishes the current state right away, false drops the snapshot.
+     * @retval None
+     */
+    void enable_snapshots(bool enable = true) {
+        snapshots = enable;
+        if (enable) {
+            publish_snapshot();
+        }
+        else {
+            atomic_store_explicit(&snapshot, shared_ptr<Summary const>(), memory_order_release);
+        }
+    }
+
+    /**
+     * @brief  Returns the last published snapshot, see enable_snapshots(). Thread-safe, also
+            while another thread calls next(). The snapshot stays valid (and unchanged)
+            as long as the caller holds it, even if newer snapshots are published.
+     * @note   Uses the atomic shared_ptr operations of the standard library. Depending on
+            the implementation these may briefly lock a pointer-sized critical section,
+            but never wait for the optimizer.
+     * @retval The snapshot or nullptr if snapshots are not enabled.
+     */
+    shared_ptr<Summary const> get_snapshot() const {
+        return atomic_load_explicit(&snapshot, memory_order_acquire);
+    }
+
     virtual unsigned int get_num_candidate_solutions() const {
         return 1;
     }
@@ -209,6 +574,20 @@ public:
         return this->get_solution().size();
     }
 
+    /**
+     * @brief  The memory used by this optimizer in bytes: the stored elements, their ids and
+            function values, the state of the function (e.g. the kernel matrices of
+            FastIVM) and the duplicate filter. The sieve optimizers add all of their
+            sieves. Unlike get_num_elements_stored() this accounts for everything which
+            grows with K, epsilon or the dimension of the data.
+     * @retval The number of bytes.
+     */
+    virtual size_t get_memory_bytes() const {
+        return sizeof(SubmodularOptimizer) + memory_bytes(solution) + ids.capacity() * sizeof(idx_t)
+            + prefix_fvals.capacity() * sizeof(data_t) + f->get_memory_bytes()
+            + (duplicates ? duplicates->get_memory_bytes() : 0);
+    }
+
     /**
      * @brief  Returns the current function value
      * @note
@@ -218,6 +597,69 @@ public:
         return fval;
     }
 
+    /**
+     * @brief  Returns the number of function queries, kernel evaluations etc. and the
+            time spent in them since this optimizer was created. All counters are
+            zero unless SUBMODULAR_METRICS is defined.
+     * @note
+     * @retval The metrics of this optimizer
+     */
+    OptimizerMetrics const& get_metrics() const {
+        return metrics;
+    }
+
+    /**
+     * @brief  Puts a duplicate filter in front of next() (and therefore of the fit()
+            variants which call next()) as well as of Greedy::fit. Every element is
+            hashed (O(D)) and exact duplicates are dropped before any function query
+            is made. Duplicates have (almost) no marginal gain for most functions, but
+            would otherwise cost a full peek, e.g. in every sieve.
+     * @note   The filter is not part of checkpoints. Random::fit samples without it.
+     * @param  mode: Drop duplicates of all seen or of all accepted elements, see
+            DuplicateMode.
+     * @param  false_positive_rate: 0 stores the hashes in a hash set, otherwise a
+            bloom filter with this false positive rate is used.
+     * @param  expected_elements: The expected number of distinct elements for the
+            bloom filter.
+     * @retval None
+     */
+    void enable_duplicate_filter(DuplicateMode mode = DuplicateMode::seen, double false_positive_rate = 0, size_t expected_elements = 1 << 20) {
+        duplicates = make_unique<DuplicateFilter>(mode, false_positive_rate, expected_elements);
+    }
+
+    // The duplicate filter or nullptr if it is not enabled
+    DuplicateFilter const* get_duplicate_filter() const {
+        return duplicates.get();
+    }
+
+    /**
+     * @brief  Writes the state of this optimizer, including the state of its
+            SubmodularFunction, so that it can be restored with load() after a restart.
+            Restoring is O(state size), no function values are re-computed. See also
+            Checkpointer in Checkpoint.h.
+     * @note   Only the state is written. load() expects an optimizer which was
+            constructed with the same parameters (K, f, epsilon, ...).
+     * @param  out: The output.
+     * @param  incremental: If true, only the changes since the last call of save()
+            or load() are written. Optimizers which cannot write a delta write a full
+            snapshot instead.
+     * @retval None
+     */
+    virtual void save(BinaryWriter& out, bool incremental = false) {
+        save_state(out, incremental ? checkpointed : 0);
+    }
+
+    /**
+     * @brief  Restores the state written by save(). An incremental checkpoint is applied
+            on top of the current state, which must be the one of the previous save().
+     * @note
+     * @param  in: The input.
+     * @retval None
+     */
+    virtual void load(BinaryReader& in) {
+        load_state(in);
+    }
+
     /**
      * @brief  Destroys this object
      * @note
@@ -0,0 +1,251 @@
+#ifndef BENCHMARK_HARNESS_H
+#define BENCHMARK_HARNESS_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief  Returns the peak resident set size of this process in bytes.
+ */
+inline size_t peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * @brief  Command line arguments of the form --key=value or --key value.
+ */
+class BenchmarkArgs {
+private:
+    map<string, string> values;
+
+public:
+    BenchmarkArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                throw runtime_error("BenchmarkArgs: Unexpected argument " + arg);
+            }
+            size_t eq = arg.find('=');
+            if (eq != string::npos) {
+                values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+            }
+            else if (i + 1 < argc) {
+                values[arg.substr(2)] = argv[++i];
+            }
+            else {
+                values[arg.substr(2)] = "";
+            }
+        }
+    }
+
+    string get_string(string const& key, string const& def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : it->second;
+    }
+
+    size_t get_size(string const& key, size_t def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : stoul(it->second);
+    }
+
+    double get_double(string const& key, double def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : stod(it->second);
+    }
+
+    // A comma separated list, e.g. --K=5,20,100
+    vector<size_t> get_list(string const& key, vector<size_t> const& def) const {
+        auto it = values.find(key);
+        if (it == values.end()) return def;
+        vector<size_t> list;
+        stringstream ss(it->second);
+        string entry;
+        while (getline(ss, entry, ',')) {
+            list.push_back(stoul(entry));
+        }
+        return list;
+    }
+};
+
+/**
+ * @brief  The result of a single benchmark case. Latencies are given in nanoseconds
+        per operation, throughput in operations per second.
+ */
+struct BenchmarkResult {
+    string name;
+    map<string, double> params;
+    map<string, double> metrics;
+    size_t operations = 0;
+    double seconds = 0;
+    vector<double> latencies;
+
+    /**
+     * @brief  Returns the p-th percentile (0 <= p <= 100) of the recorded latencies
+            using the nearest-rank method.
+     */
+    double percentile(double p) const {
+        if (latencies.empty()) return 0;
+        vector<double> sorted(latencies);
+        sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(ceil(p / 100.0 * sorted.size()));
+        return sorted[min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    double throughput() const {
+        return seconds > 0 ? operations / seconds : 0;
+    }
+};
+
+/**
+ * @brief  Collects benchmark results and writes them as JSON, either to stdout or to
+        the file given by --json=<path>. Every result also records the peak RSS of
+        the process at the time it was added.
+ */
+class BenchmarkReport {
+private:
+    string suite;
+    vector<BenchmarkResult> results;
+    vector<size_t> rss;
+
+    static string escape(string const& s) {
+        string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    static string number(double v) {
+        if (!isfinite(v)) return "null";
+        ostringstream ss;
+        ss.precision(12);
+        ss << v;
+        return ss.str();
+    }
+
+public:
+    explicit BenchmarkReport(string const& suite) : suite(suite) {}
+
+    void add(BenchmarkResult const& result) {
+        results.push_back(result);
+        rss.push_back(peak_rss_bytes());
+        cerr << result.name << ": " << result.throughput() << " ops/s, p50 "
+            << result.percentile(50) << " ns, p99 " << result.percentile(99) << " ns" << endl;
+    }
+
+    void write(ostream& out) const {
+        out << "{\n  \"suite\": \"" << escape(suite) << "\",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto const& r = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << escape(r.name) << "\"";
+            out << ", \"params\": {";
+            size_t j = 0;
+            for (auto const& p : r.params) {
+                out << (j++ == 0 ? "" : ", ") << "\"" << escape(p.first) << "\": " << number(p.second);
+            }
+            out << "}, \"operations\": " << r.operations
+                << ", \"seconds\": " << number(r.seconds)
+                << ", \"throughput\": " << number(r.throughput())
+                << ", \"latency_ns\": {\"p50\": " << number(r.percentile(50))
+                << ", \"p90\": " << number(r.percentile(90))
+                << ", \"p99\": " << number(r.percentile(99))
+                << ", \"p999\": " << number(r.percentile(99.9))
+                << ", \"max\": " << number(r.percentile(100)) << "}"
+                << ", \"peak_rss_bytes\": " << rss[i];
+            for (auto const& m : r.metrics) {
+                out << ", \"" << escape(m.first) << "\": " << number(m.second);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}" << endl;
+    }
+
+    void write(BenchmarkArgs const& args) const {
+        string path = args.get_string("json", "");
+        if (path.empty()) {
+            write(cout);
+        }
+        else {
+            ofstream out(path);
+            write(out);
+        }
+    }
+};
+
+/**
+ * @brief  Repeatedly runs `op' for at least `min_seconds' and records the latency of
+        every batch of `batch' calls divided by the batch size. Batching keeps the
+        timer overhead out of nanosecond-scale operations.
+ * @param  name: The name of the benchmark case.
+ * @param  op: The operation to be measured.
+ * @param  min_seconds: The minimum total runtime.
+ * @param  batch: Number of calls per latency sample.
+ * @retval The benchmark result.
+ */
+template <typename F>
+BenchmarkResult measure_repeated(string const& name, F&& op, double min_seconds = 0.2, size_t batch = 1) {
+    BenchmarkResult result;
+    result.name = name;
+
+    auto begin = chrono::steady_clock::now();
+    auto now = begin;
+    do {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            op();
+        }
+        now = chrono::steady_clock::now();
+        result.latencies.push_back(chrono::duration<double, nano>(now - start).count() / batch);
+        result.operations += batch;
+    } while (chrono::duration<double>(now - begin).count() < min_seconds);
+
+    result.seconds = chrono::duration<double>(now - begin).count();
+    return result;
+}
+
+// Keeps the compiler from optimizing away benchmarked results
+template <typename T>
+inline void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile char const* sink;
+    sink = reinterpret_cast<char const*>(&value);
+#endif
+}
+
+#endif // BENCHMARK_HARNESS_H
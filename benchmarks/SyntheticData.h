@@ -0,0 +1,112 @@
+#ifndef SYNTHETIC_DATA_H
+#define SYNTHETIC_DATA_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+#include "../DataTypeHandling.h"
+#include "../FeatureCoverage.h"
+
+using namespace std;
+
+/**
+ * @brief  Samples N points with D features from a mixture of isotropic Gaussian blobs.
+        The centers are drawn uniformly from [0, 1]^D and every feature is clipped to
+        [0, 1] afterwards, so the data looks like the min-max normalized KDDCup99 /
+        Creditcard features used in main.cpp. Sampling is always done in double, so
+        the float32 and float64 builds see the same (rounded) data for a given seed.
+ * @param  N: Number of points.
+ * @param  D: Number of features per point.
+ * @param  centers: Number of blobs.
+ * @param  spread: Standard deviation of each blob.
+ * @param  seed: The random seed.
+ * @retval The sampled data set.
+ */
+inline vector<vector<data_t>> make_blobs(size_t N, size_t D, size_t centers = 16,
+    double spread = 0.05, unsigned long seed = 0) {
+    default_random_engine gen(seed);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    normal_distribution<double> noise(0.0, spread);
+
+    vector<vector<double>> C(centers, vector<double>(D));
+    for (auto& c : C) {
+        for (auto& ci : c) {
+            ci = uniform(gen);
+        }
+    }
+
+    uniform_int_distribution<size_t> pick(0, centers - 1);
+    vector<vector<data_t>> X(N, vector<data_t>(D));
+    for (auto& x : X) {
+        auto const& c = C[pick(gen)];
+        for (size_t d = 0; d < D; ++d) {
+            x[d] = static_cast<data_t>(min(max(c[d] + noise(gen), 0.0), 1.0));
+        }
+    }
+
+    return X;
+}
+
+/**
+ * @brief  Writes X as an ARFF file shaped like KDDCup99: one real attribute per
+        feature followed by an integer id and a nominal label.
+ * @param  path: The output file.
+ * @param  X: The data set to be written.
+ * @retval None
+ */
+inline void write_arff(string const& path, vector<vector<data_t>> const& X) {
+    ofstream out(path);
+    out << "@RELATION 'synthetic'\n\n";
+    for (size_t d = 0; d < (X.empty() ? 0 : X[0].size()); ++d) {
+        out << "@ATTRIBUTE 'f" << d << "' real\n";
+    }
+    out << "@ATTRIBUTE 'id' integer\n@ATTRIBUTE 'outlier' {'yes','no'}\n\n@DATA\n";
+    for (size_t i = 0; i < X.size(); ++i) {
+        for (auto xi : X[i]) {
+            out << xi << ",";
+        }
+        out << i << ",'no'\n";
+    }
+}
+
+/**
+ * @brief  Samples N sparse events over F features. Every event has nnz distinct
+        features drawn from a Zipf-like distribution (feature j with probability
+        ~ 1 / (j + 1)) with counts in [1, 5], like bag-of-words event logs.
+ * @param  N: Number of events.
+ * @param  F: Number of features.
+ * @param  nnz: Number of non-zero features per event.
+ * @param  seed: The random seed.
+ * @retval The events in CSR format.
+ */
+inline CSRMatrix make_sparse_events(size_t N, size_t F, size_t nnz, unsigned long seed = 0) {
+    default_random_engine gen(seed);
+    vector<double> p(F);
+    for (size_t j = 0; j < F; ++j) p[j] = 1.0 / (j + 1);
+    discrete_distribution<idx_t> pick(p.begin(), p.end());
+    uniform_int_distribution<int> count(1, 5);
+
+    CSRMatrix X;
+    X.num_features = F;
+    nnz = min(nnz, F);
+    vector<idx_t> indices;
+    vector<data_t> values;
+    for (size_t i = 0; i < N; ++i) {
+        indices.clear();
+        values.clear();
+        while (indices.size() < nnz) {
+            idx_t j = pick(gen);
+            if (find(indices.begin(), indices.end(), j) == indices.end()) {
+                indices.push_back(j);
+                values.push_back(static_cast<data_t>(count(gen)));
+            }
+        }
+        X.push_back(indices, values);
+    }
+    return X;
+}
+
+#endif // SYNTHETIC_DATA_H
@@ -0,0 +1,77 @@
+/*
+* Startup benchmark for the binary data set format.
+*
+* Converts a (synthetic) ARFF file into the binary format once and then compares
+* the time until the first optimizer can start: parsing the ARFF file with
+* load_arff versus mapping the binary file with MappedDataset. The time of one
+* full pass over the rows is reported separately, because the mapped rows are
+* only paged in on first access.
+*
+* Usage: binary_dataset_benchmark [N] [D] [path.arff]
+*/
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+
+#include "../BinaryDataset.h"
+#include "SyntheticData.h"
+
+using namespace std;
+
+template <typename F>
+double measure(F&& f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double>(end - start).count();
+}
+
+// Keeps the compiler from dropping the passes over the data
+volatile data_t sink;
+
+data_t checksum(DatasetView const& X) {
+    data_t sum = 0;
+    for (size_t i = 0; i < X.size(); ++i) {
+        for (size_t d = 0; d < X.dimension(); ++d) {
+            sum += X.row(i)[d];
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    size_t N = argc > 1 ? stoul(argv[1]) : 500000;
+    size_t D = argc > 2 ? stoul(argv[2]) : 41;
+    string path = argc > 3 ? argv[3] : "binary_dataset_benchmark.arff";
+    string binary_path = path + ".bin";
+
+    if (argc <= 3) {
+        cout << "Writing " << N << " x " << D << " synthetic rows to " << path << endl;
+        write_arff(path, make_blobs(N, D));
+    }
+
+    DatasetLoaderOptions options;
+    options.exclude = { "id" };
+
+    double t_convert = measure([&]() { convert_arff_to_binary(path, binary_path, options); });
+
+    Dataset parsed;
+    double t_arff = measure([&]() { parsed = load_arff(path, options); });
+    double t_arff_pass = measure([&]() { sink = checksum(parsed.view()); });
+
+    unique_ptr<MappedDataset> mapped;
+    double t_map = measure([&]() { mapped.reset(new MappedDataset(binary_path)); });
+    double t_map_pass = measure([&]() { sink = checksum(mapped->view()); });
+
+    cout << "rows: " << mapped->size() << "; dimensions: " << mapped->dimension() << endl;
+    cout << "convert (once):\t" << t_convert << "s" << endl;
+    cout << "load_arff startup:\t" << t_arff * 1000 << "ms\tfirst pass: " << t_arff_pass * 1000 << "ms" << endl;
+    cout << "MappedDataset startup:\t" << t_map * 1000 << "ms\tfirst pass: " << t_map_pass * 1000 << "ms" << endl;
+
+    mapped.reset();
+    remove(binary_path.c_str());
+    if (argc <= 3) {
+        remove(path.c_str());
+    }
+}
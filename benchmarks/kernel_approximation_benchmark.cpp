@@ -0,0 +1,132 @@
+/*
+* Quality vs. speed of the approximate kernels in KernelApproximation.h.
+*
+* Every configuration selects K rows with Greedy and with SieveStreaming on the same
+* synthetic blob data. Approximate configurations project all rows first (the
+* projection time is part of the runtime) and then optimize either FastIVM with a
+* DotProductKernel or LowRankIVM on the projected rows. The selected ids are then
+* re-evaluated with the exact RBF objective:
+*   - "fval": the exact objective of the selected rows
+*   - "deviation": relative loss of "fval" compared to the exact configuration
+*   - "speedup": runtime of the exact configuration / runtime of this configuration
+*
+* Usage: kernel_approximation_benchmark [--N=20000] [--D=128] [--K=10]
+*            [--features=16,64,256] [--eps=0.1] [--json=<path>]
+*/
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <functional>
+
+#include "../FastIVM.h"
+#include "../IVM.h"
+#include "../LowRankIVM.h"
+#include "../RBFKernel.h"
+#include "../KernelApproximation.h"
+#include "../Greedy.h"
+#include "../SieveStreaming.h"
+#include "BenchmarkHarness.h"
+#include "SyntheticData.h"
+
+using namespace std;
+
+struct Selection {
+    vector<idx_t> ids;
+    double seconds;
+};
+
+// Runs Greedy or SieveStreaming with the function f on Z (projected or original rows)
+Selection select(string const& optimizer, SubmodularFunction& f, vector<vector<data_t>> const& Z,
+    unsigned int K, double eps) {
+    vector<idx_t> ids(Z.size());
+    iota(ids.begin(), ids.end(), 0);
+
+    auto start = chrono::steady_clock::now();
+    vector<idx_t> selected;
+    if (optimizer == "Greedy") {
+        Greedy greedy(K, f);
+        greedy.fit(Z, ids);
+        selected = greedy.get_ids();
+    }
+    else {
+        SieveStreaming sieve(K, f, 1.0, eps);
+        sieve.fit(Z, ids);
+        selected = sieve.get_ids();
+    }
+    return { selected, chrono::duration<double>(chrono::steady_clock::now() - start).count() };
+}
+
+int main(int argc, char** argv) {
+    BenchmarkArgs args(argc, argv);
+    size_t N = args.get_size("N", 20000);
+    size_t D = args.get_size("D", 128);
+    unsigned int K = static_cast<unsigned int>(args.get_size("K", 10));
+    double eps = args.get_double("eps", 0.1);
+    vector<size_t> features = args.get_list("features", { 16, 64, 256 });
+
+    auto X = make_blobs(N, D);
+    data_t kernel_sigma = sqrt(static_cast<data_t>(D));
+    RBFKernel rbf(kernel_sigma, 1.0);
+
+    // The exact objective of a selection
+    IVM exact(rbf, 1.0);
+    auto exact_fval = [&](vector<idx_t> const& ids) {
+        vector<vector<data_t>> S;
+        for (auto i : ids) S.push_back(X[i]);
+        return exact(S);
+    };
+
+    Dataset flat(N, D);
+    for (size_t i = 0; i < N; ++i) copy(X[i].begin(), X[i].end(), flat.row(i));
+
+    BenchmarkReport report("kernel_approximation");
+
+    for (string optimizer : { "Greedy", "SieveStreaming" }) {
+        FastIVM f(K, rbf, 1.0);
+        Selection reference = select(optimizer, f, X, K, eps);
+        double reference_fval = exact_fval(reference.ids);
+
+        auto add = [&](string const& name, size_t m, Selection const& s) {
+            BenchmarkResult result;
+            result.name = optimizer + "/" + name;
+            result.params["K"] = K;
+            result.params["D"] = D;
+            result.params["m"] = m;
+            result.operations = N;
+            result.seconds = s.seconds;
+            double fval = exact_fval(s.ids);
+            result.metrics["fval"] = fval;
+            result.metrics["deviation"] = (reference_fval - fval) / reference_fval;
+            result.metrics["speedup"] = reference.seconds / s.seconds;
+            report.add(result);
+        };
+        add("exact", D, reference);
+
+        for (auto m : features) {
+            vector<pair<string, shared_ptr<FeatureMap>>> maps = {
+                { "rff", make_shared<RandomFourierFeatures>(D, m, kernel_sigma, 1.0, 0) },
+                { "nystroem", make_shared<NystroemFeatures>(rbf, sample_landmarks(flat.view(), m, 0)) }
+            };
+
+            for (auto& map : maps) {
+                auto start = chrono::steady_clock::now();
+                auto Z = map.second->transform(X);
+                double projection = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                FastIVM dot(K, DotProductKernel(), 1.0);
+                Selection s = select(optimizer, dot, Z, K, eps);
+                s.seconds += projection;
+                add(map.first + "+FastIVM", m, s);
+
+                LowRankIVM low_rank(static_cast<unsigned int>(m), 1.0);
+                s = select(optimizer, low_rank, Z, K, eps);
+                s.seconds += projection;
+                add(map.first + "+LowRankIVM", m, s);
+            }
+        }
+    }
+
+    report.write(args);
+}
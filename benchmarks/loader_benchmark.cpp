@@ -0,0 +1,97 @@
+/*
+* Throughput benchmark for the ARFF loader.
+*
+* Compares the former getline / stringstream / atof reader of main.cpp with
+* load_arff using one thread and using all hardware threads, and reports MB/s.
+* Without a path a synthetic ARFF file shaped like KDDCup99 (D numeric features,
+* an integer id and a nominal label) is written to the working directory first.
+*
+* Usage: loader_benchmark [N] [D] [path.arff]
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+
+#include "../DatasetLoader.h"
+#include "SyntheticData.h"
+
+using namespace std;
+
+// The reader main.cpp used before DatasetLoader.h, kept as the baseline
+vector<vector<data_t>> read_arff_getline(string const& path, size_t D) {
+    vector<vector<data_t>> X;
+
+    string line;
+    ifstream file(path);
+
+    if (file.is_open()) {
+        while (getline(file, line)) {
+            if (line.size() > 0 && line[0] != '@' && line != "\r") {
+                vector<data_t> x;
+                stringstream ss(line);
+                string entry;
+                while (getline(ss, entry, ',') && x.size() < D) {
+                    if (entry.size() > 0) {
+                        x.push_back(static_cast<float>(atof(entry.c_str())));
+                    }
+                }
+                if (X.size() == 0 || x.size() == X[0].size()) {
+                    X.push_back(x);
+                }
+            }
+        }
+        file.close();
+    }
+
+    return X;
+}
+
+template <typename F>
+void report(string const& name, size_t bytes, F&& load) {
+    auto start = chrono::steady_clock::now();
+    size_t rows = load();
+    auto end = chrono::steady_clock::now();
+    chrono::duration<double> runtime_seconds = end - start;
+    cout << name << "\t" << rows << "\t" << runtime_seconds.count() << "s\t"
+        << bytes / runtime_seconds.count() / (1 << 20) << " MB/s" << endl;
+}
+
+int main(int argc, char** argv) {
+    size_t N = argc > 1 ? stoul(argv[1]) : 500000;
+    size_t D = argc > 2 ? stoul(argv[2]) : 41;
+    string path = argc > 3 ? argv[3] : "loader_benchmark.arff";
+
+    if (argc <= 3) {
+        cout << "Writing " << N << " x " << D << " synthetic rows to " << path << endl;
+        write_arff(path, make_blobs(N, D));
+    }
+
+    size_t bytes;
+    {
+        MemoryMappedFile file(path);
+        bytes = file.size();
+        // Touch the file once so that every reader starts from a warm page cache
+        volatile char sink = 0;
+        for (size_t i = 0; i < bytes; i += 4096) sink += file.data()[i];
+    }
+
+    DatasetLoaderOptions options;
+    options.exclude = { "id" };
+
+    cout << "reader\trows\truntime\tthroughput" << endl;
+    report("getline", bytes, [&]() { return read_arff_getline(path, D).size(); });
+
+    options.num_threads = 1;
+    report("load_arff(1 thread)", bytes, [&]() { return load_arff(path, options).size(); });
+
+    options.num_threads = 0;
+    report("load_arff(" + to_string(max(1u, thread::hardware_concurrency())) + " threads)", bytes,
+        [&]() { return load_arff(path, options).size(); });
+
+    if (argc <= 3) {
+        remove(path.c_str());
+    }
+}
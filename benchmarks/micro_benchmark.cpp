@@ -0,0 +1,176 @@
+/*
+* Micro-benchmarks for the building blocks of the log-det objective:
+*   - RBFKernel::operator() for several D
+*   - cholesky for several N
+*   - FastIVM::peek / FastIVM::update and IVM::peek for several K and D
+*   - FacilityLocation::peek (dense and on the k-nearest-neighbor graph) for several V
+*   - FeatureCoverage::peek vs. the same objective in a SubmodularFunctionWrapper for
+*     sparse events with several nnz
+*
+* Usage: micro_benchmark [--D=8,41,128,512] [--N=5,20,50,100] [--K=5,20,100]
+*                        [--V=1000,4000] [--knn=10] [--nnz=8,64] [--min_seconds=0.2]
+*                        [--json=<path>]
+*/
+#include <iostream>
+#include <string>
+#include <cmath>
+
+#include "../FastIVM.h"
+#include "../IVM.h"
+#include "../FacilityLocation.h"
+#include "../FeatureCoverage.h"
+#include "../RBFKernel.h"
+#include "../Matrix.h"
+#include "BenchmarkHarness.h"
+#include "SyntheticData.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    BenchmarkArgs args(argc, argv);
+    double min_seconds = args.get_double("min_seconds", 0.2);
+    vector<size_t> Ds = args.get_list("D", { 8, 41, 128, 512 });
+    vector<size_t> Ns = args.get_list("N", { 5, 20, 50, 100 });
+    vector<size_t> Ks = args.get_list("K", { 5, 20, 100 });
+    vector<size_t> Vs = args.get_list("V", { 1000, 4000 });
+    size_t knn = args.get_size("knn", 10);
+    vector<size_t> nnzs = args.get_list("nnz", { 8, 64 });
+
+    BenchmarkReport report("micro");
+
+    for (auto D : Ds) {
+        auto X = make_blobs(1024, D);
+        RBFKernel kernel(sqrt(static_cast<data_t>(D)), 1.0);
+        size_t i = 0;
+        auto result = measure_repeated("RBFKernel", [&]() {
+            data_t k = kernel(X[i % X.size()], X[(i + 1) % X.size()]);
+            do_not_optimize(k);
+            ++i;
+        }, min_seconds, 1000);
+        result.params["D"] = D;
+        report.add(result);
+    }
+
+    for (auto N : Ns) {
+        auto X = make_blobs(N, 41);
+        RBFKernel kernel(sqrt(41.0), 1.0);
+        Matrix kmat(N);
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < N; ++j) {
+                kmat(i, j) = kernel(X[i], X[j]) + (i == j ? 1.0 : 0.0);
+            }
+        }
+        auto result = measure_repeated("cholesky", [&]() {
+            Matrix L = cholesky(kmat);
+            do_not_optimize(L(N - 1, N - 1));
+        }, min_seconds, max<size_t>(1, 10000 / (N * N)));
+        result.params["N"] = N;
+        report.add(result);
+    }
+
+    for (auto D : Ds) {
+        auto X = make_blobs(4096, D);
+        RBFKernel kernel(sqrt(static_cast<data_t>(D)), 1.0);
+
+        for (auto K : Ks) {
+            // A function which already holds K - 1 elements, so peek extends it to K
+            FastIVM f(K, kernel, 1.0);
+            vector<vector<data_t>> solution;
+            for (size_t k = 0; k + 1 < K; ++k) {
+                f.update(solution, X[k], solution.size());
+                solution.push_back(X[k]);
+            }
+
+            size_t i = K;
+            auto peek = measure_repeated("FastIVM::peek", [&]() {
+                data_t v = f.peek(solution, X[i % X.size()], solution.size());
+                do_not_optimize(v);
+                ++i;
+            }, min_seconds, 100);
+            peek.params["K"] = K;
+            peek.params["D"] = D;
+            report.add(peek);
+
+            // The same query with IVM, which extends its cached Cholesky factor by one row
+            IVM ivm(kernel, 1.0);
+            auto ivm_peek = measure_repeated("IVM::peek", [&]() {
+                data_t v = ivm.peek(solution, X[i % X.size()], solution.size());
+                do_not_optimize(v);
+                ++i;
+            }, min_seconds, 1);
+            ivm_peek.params["K"] = K;
+            ivm_peek.params["D"] = D;
+            report.add(ivm_peek);
+
+            // Fill a fresh function with K elements, every update is one sample
+            FastIVM g(K, kernel, 1.0);
+            vector<vector<data_t>> grown;
+            i = 0;
+            auto update = measure_repeated("FastIVM::update", [&]() {
+                if (grown.size() == K) {
+                    g = FastIVM(K, kernel, 1.0);
+                    grown.clear();
+                }
+                g.update(grown, X[i % X.size()], grown.size());
+                grown.push_back(X[i % X.size()]);
+                ++i;
+            }, min_seconds, 1);
+            update.params["K"] = K;
+            update.params["D"] = D;
+            report.add(update);
+        }
+    }
+
+    for (auto V : Vs) {
+        auto X = make_blobs(V, 41);
+        RBFKernel kernel(sqrt(41.0), 1.0);
+        FacilityLocation dense(X, kernel);
+        FacilityLocation sparse(X, kernel, knn);
+
+        for (auto f : { &dense, &sparse }) {
+            // A function which already holds 10 elements
+            vector<vector<data_t>> solution;
+            for (size_t k = 0; k < 10; ++k) {
+                f->update(solution, X[k], solution.size());
+                solution.push_back(X[k]);
+            }
+
+            size_t i = 10;
+            auto peek = measure_repeated(f == &dense ? "FacilityLocation::peek/dense" : "FacilityLocation::peek/sparse", [&]() {
+                data_t v = f->peek(solution, X[i % X.size()], solution.size());
+                do_not_optimize(v);
+                ++i;
+            }, min_seconds, f == &dense ? 1 : 100);
+            peek.params["V"] = V;
+            if (f == &sparse) peek.params["knn"] = knn;
+            report.add(peek);
+        }
+    }
+
+    for (auto nnz : nnzs) {
+        size_t F = 100000;
+        auto X = make_sparse_events(4096, F, nnz).rows();
+        FeatureCoverage coverage(F, Concave::sqrt);
+        SubmodularFunctionWrapper wrapper([&coverage](vector<vector<data_t>> const& S) { return coverage(S); });
+
+        for (auto f : vector<SubmodularFunction*>{ &coverage, &wrapper }) {
+            // A function which already holds 20 elements
+            vector<vector<data_t>> solution;
+            for (size_t k = 0; k < 20; ++k) {
+                f->update(solution, X[k], solution.size());
+                solution.push_back(X[k]);
+            }
+
+            size_t i = 20;
+            auto peek = measure_repeated(f == &coverage ? "FeatureCoverage::peek" : "SubmodularFunctionWrapper::peek", [&]() {
+                data_t v = f->peek(solution, X[i % X.size()], solution.size());
+                do_not_optimize(v);
+                ++i;
+            }, min_seconds, f == &coverage ? 1000 : 1);
+            peek.params["nnz"] = nnz;
+            report.add(peek);
+        }
+    }
+
+    report.write(args);
+}
@@ -0,0 +1,249 @@
+/*
+* Macro-benchmarks for every optimizer on synthetic Gaussian-blob data.
+*
+* The streaming optimizers (Random, SieveStreaming, SieveStreaming++) are timed
+* per call of next(), so the reported percentiles are per-element latencies.
+* Greedy and FastGreedyMAP are not streaming algorithms, here every latency sample
+* is one complete fit() divided by N and the run is repeated --repeat times.
+*
+* FanOut runs all SieveStreaming / SieveStreaming++ configurations of one K in a
+* single pass on --threads threads (0 = all hardware threads) with a shared kernel
+* cache, its throughput is elements per second for all configurations together.
+*
+* Ingest feeds one SieveStreaming++ from --producers threads, once through an
+* external mutex around next() and once through a ConcurrentIngestor.
+*
+* With --trace=<prefix> the sieve optimizers additionally record a LatencyTrace,
+* which is written to <prefix><name>_K<K>_eps<eps>.json (Chrome trace) and .hgrm
+* (HdrHistogram percentile distribution).
+*
+* Usage: optimizer_benchmark [--N=20000] [--D=41] [--K=5,20] [--eps=0.01,0.1]
+*                            [--repeat=3] [--threads=0] [--producers=4] [--trace=<prefix>]
+*                            [--json=<path>]
+*/
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <fstream>
+#include <thread>
+#include <mutex>
+
+#include "../FastIVM.h"
+#include "../RBFKernel.h"
+#include "../Greedy.h"
+#include "../FastGreedyMAP.h"
+#include "../Random.h"
+#include "../SieveStreaming.h"
+#include "../SieveStreamingPP.h"
+#include "../FanOut.h"
+#include "../ConcurrentIngestor.h"
+#include "BenchmarkHarness.h"
+#include "SyntheticData.h"
+
+using namespace std;
+
+// The instrumentation counters of opt, only available if built with SUBMODULAR_METRICS
+void add_call_counts(BenchmarkResult& result, SubmodularOptimizer const& opt) {
+    if (!OptimizerMetrics::enabled) return;
+    for (size_t i = 0; i < NUM_METRIC_EVENTS; ++i) {
+        MetricEvent e = static_cast<MetricEvent>(i);
+        result.metrics[string(to_string(e)) + "_calls"] = opt.get_metrics().calls(e);
+        result.metrics[string(to_string(e)) + "_seconds"] = opt.get_metrics().seconds(e);
+    }
+}
+
+BenchmarkResult stream(string const& name, SubmodularOptimizer& opt, vector<vector<data_t>> const& X) {
+    BenchmarkResult result;
+    result.name = name;
+    result.latencies.reserve(X.size());
+
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < X.size(); ++i) {
+        auto start = chrono::steady_clock::now();
+        opt.next(X[i], static_cast<idx_t>(i));
+        result.latencies.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    result.operations = X.size();
+
+    result.metrics["fval"] = opt.get_fval();
+    result.metrics["num_candidate_solutions"] = opt.get_num_candidate_solutions();
+    result.metrics["num_elements_stored"] = opt.get_num_elements_stored();
+    result.metrics["memory_bytes"] = opt.get_memory_bytes();
+    add_call_counts(result, opt);
+    return result;
+}
+
+// Repeated fit() of a non-streaming optimizer, every latency sample is one fit() divided by N
+template <typename Optimizer>
+BenchmarkResult batch(string const& name, size_t K, FastIVM& f, vector<vector<data_t>> const& X, size_t repeat) {
+    BenchmarkResult result;
+    result.name = name;
+    for (size_t r = 0; r < repeat; ++r) {
+        Optimizer opt(K, f);
+        auto start = chrono::steady_clock::now();
+        opt.fit(X);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        result.latencies.push_back(seconds * 1e9 / X.size());
+        result.seconds += seconds;
+        result.operations += X.size();
+        result.metrics["fval"] = opt.get_fval();
+        add_call_counts(result, opt);
+    }
+    result.params["K"] = K;
+    return result;
+}
+
+// All sieve configurations for K in a single pass through a FanOut
+BenchmarkResult sweep(size_t K, data_t kernel_sigma, vector<double> const& epsilons, vector<vector<data_t>> const& X, unsigned int threads) {
+    FanOut fan(threads);
+    FastIVM f(K, RBFKernel(kernel_sigma, 1.0), 1.0);
+    f.share_kernel_cache(fan.get_kernel_cache());
+    for (auto eps : epsilons) {
+        fan.emplace<SieveStreaming>(K, f, 1.0, eps);
+        fan.emplace<SieveStreamingPP>(K, f, 1.0, eps);
+    }
+
+    BenchmarkResult result;
+    result.name = "FanOut";
+    auto begin = chrono::steady_clock::now();
+    fan.fit(X);
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    result.operations = X.size();
+
+    data_t fval = 0;
+    for (size_t i = 0; i < fan.size(); ++i) {
+        fval = max(fval, fan[i].get_fval());
+    }
+    result.params["K"] = K;
+    result.params["threads"] = fan.get_num_threads();
+    result.params["num_optimizers"] = fan.size();
+    result.metrics["fval"] = fval;
+    result.metrics["cache_hits"] = fan.get_kernel_cache()->get_hits();
+    result.metrics["cache_misses"] = fan.get_kernel_cache()->get_misses();
+    return result;
+}
+
+// Several producer threads feed one SieveStreaming++, either through a mutex or a ConcurrentIngestor
+BenchmarkResult ingest(size_t K, FastIVM& f, double eps, vector<vector<data_t>> const& X, unsigned int producers, bool lock_free) {
+    SieveStreamingPP opt(K, f, 1.0, eps);
+    mutex lock;
+    unique_ptr<ConcurrentIngestor> ingestor;
+    if (lock_free) {
+        ingestor.reset(new ConcurrentIngestor(opt));
+    }
+
+    BenchmarkResult result;
+    result.name = lock_free ? "Ingest (ConcurrentIngestor)" : "Ingest (mutex)";
+    auto begin = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (unsigned int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = p; i < X.size(); i += producers) {
+                if (lock_free) {
+                    ingestor->push(X[i], i);
+                }
+                else {
+                    lock_guard<mutex> guard(lock);
+                    opt.next(X[i], i);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (lock_free) {
+        ingestor->close();
+        result.metrics["rejected"] = ingestor->get_num_rejected();
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    result.operations = X.size();
+
+    result.params["K"] = K;
+    result.params["eps"] = eps;
+    result.params["producers"] = producers;
+    result.metrics["fval"] = opt.get_fval();
+    return result;
+}
+
+// Writes the trace of a sieve optimizer, if there is one
+void write_trace(SubmodularOptimizer const& opt, string const& path) {
+    LatencyTrace const* trace = nullptr;
+    if (auto sieve = dynamic_cast<SieveStreaming const*>(&opt)) trace = sieve->get_trace();
+    if (auto sieve = dynamic_cast<SieveStreamingPP const*>(&opt)) trace = sieve->get_trace();
+    if (trace == nullptr) return;
+
+    ofstream json(path + ".json");
+    trace->write_chrome_trace(json);
+    ofstream hgrm(path + ".hgrm");
+    trace->histogram().write_percentiles(hgrm);
+}
+
+int main(int argc, char** argv) {
+    BenchmarkArgs args(argc, argv);
+    size_t N = args.get_size("N", 20000);
+    size_t D = args.get_size("D", 41);
+    size_t repeat = args.get_size("repeat", 3);
+    unsigned int threads = static_cast<unsigned int>(args.get_size("threads", 0));
+    unsigned int producers = static_cast<unsigned int>(max<size_t>(1, args.get_size("producers", 4)));
+    string trace_prefix = args.get_string("trace", "");
+    vector<size_t> Ks = args.get_list("K", { 5, 20 });
+
+    vector<double> epsilons;
+    stringstream ss(args.get_string("eps", "0.01,0.1"));
+    string entry;
+    while (getline(ss, entry, ',')) {
+        epsilons.push_back(stod(entry));
+    }
+
+    auto X = make_blobs(N, D);
+    data_t kernel_sigma = sqrt(static_cast<data_t>(D));
+
+    BenchmarkReport report("optimizer");
+
+    for (auto K : Ks) {
+        FastIVM fastIVM(K, RBFKernel(kernel_sigma, 1.0), 1.0);
+
+        report.add(batch<Greedy>("Greedy", K, fastIVM, X, repeat));
+        report.add(batch<FastGreedyMAP>("FastGreedyMAP", K, fastIVM, X, repeat));
+
+        vector<pair<string, unique_ptr<SubmodularOptimizer>>> optimizers;
+        optimizers.emplace_back("Random", unique_ptr<SubmodularOptimizer>(new Random(K, fastIVM, 0)));
+        for (auto eps : epsilons) {
+            auto sieve = new SieveStreaming(K, fastIVM, 1.0, eps);
+            auto sievepp = new SieveStreamingPP(K, fastIVM, 1.0, eps);
+            if (!trace_prefix.empty()) {
+                sieve->enable_tracing(N);
+                sievepp->enable_tracing(N);
+            }
+            optimizers.emplace_back("SieveStreaming", unique_ptr<SubmodularOptimizer>(sieve));
+            optimizers.emplace_back("SieveStreaming++", unique_ptr<SubmodularOptimizer>(sievepp));
+        }
+
+        size_t eps_index = 0;
+        for (auto& opt : optimizers) {
+            auto result = stream(opt.first, *opt.second, X);
+            result.params["K"] = K;
+            if (opt.first != "Random") {
+                result.params["eps"] = epsilons[eps_index++ / 2];
+                if (!trace_prefix.empty()) {
+                    write_trace(*opt.second, trace_prefix + opt.first + "_K" + to_string(K)
+                        + "_eps" + to_string(result.params["eps"]));
+                }
+            }
+            report.add(result);
+            // Free the stored elements before the next optimizer runs
+            opt.second.reset();
+        }
+
+        report.add(sweep(K, kernel_sigma, epsilons, X, threads));
+        report.add(ingest(K, fastIVM, epsilons.front(), X, producers, false));
+        report.add(ingest(K, fastIVM, epsilons.front(), X, producers, true));
+    }
+
+    report.write(args);
+}
@@ -13,65 +13,45 @@
 #include "Random.h"
 #include "SieveStreaming.h"
 #include "SieveStreamingPP.h"
+#include "FanOut.h"
 
 #include "DataTypeHandling.h"
+#include "DatasetLoader.h"
+#include "BinaryDataset.h"
 
 using namespace std;
 
-vector<vector<data_t>> read_arff(string const& path) {
-    vector<vector<data_t>> X;
-
-    string line;
-    ifstream file(path);
-
-    if (file.is_open()) {
-        while (getline(file, line)) {
-            // Skip every meta information
-            if (line.size() > 0 && line[0] != '@' && line != "\r") {
-                vector<data_t> x;
-                stringstream ss(line);
-                string entry;
-                // All entries are float, but the last one (the label, string) and the second to last(the id, integer). Skip both.
-                while (getline(ss, entry, ',') && x.size() < 41) {
-                    if (entry.size() > 0) { //&& entry[0] != '\''
-                        x.push_back(static_cast<float>(atof(entry.c_str())));
-                    }
-                }
-                if (X.size() > 0 && x.size() != X[0].size()) {
-                    cout << "Size mismatch detected. Ignoring line." << std::endl;
-                }
-                else {
-                    X.push_back(x);
-                }
-            }
-        }
-        file.close();
-    }
-
-    return X;
-}
-
-auto evaluate_optimizer(SubmodularOptimizer& opt, vector<vector<data_t>>& X) {
+auto evaluate_optimizer(SubmodularOptimizer& opt, DatasetView const& X) {
     auto start = chrono::steady_clock::now();
     opt.fit(X);
     auto end = chrono::steady_clock::now();
     chrono::duration<double> runtime_seconds = end - start;
     auto fval = opt.get_fval();
     cout << "Selected " << opt.get_solution().size() << endl;
-    //յĺֵʱ䣻洢Ԫظѡ⼯ĸ
+    if (OptimizerMetrics::enabled) {
+        cout << "Metrics ";
+        write_json(cout, opt.get_metrics());
+        cout << endl;
+    }
+    //最终的函数值；运行时间；存储元素个数；候选解集的个数
     return make_tuple(fval, runtime_seconds.count(), opt.get_num_elements_stored(), opt.get_num_candidate_solutions());
 }
 
 
 //greedy
-auto evaluate_optimizer_ids(SubmodularOptimizer& opt, vector<vector<data_t>>& X, vector<idx_t> ids) {
+auto evaluate_optimizer_ids(SubmodularOptimizer& opt, DatasetView const& X, vector<idx_t> ids) {
     auto start = chrono::steady_clock::now();
     opt.fit(X,ids);
     auto end = chrono::steady_clock::now();
     chrono::duration<double> runtime_seconds = end - start;
     auto fval = opt.get_fval();
     cout << "Selected " << opt.get_solution().size() << endl;
-    //յĺֵʱ䣻洢Ԫظѡ⼯ĸ
+    if (OptimizerMetrics::enabled) {
+        cout << "Metrics ";
+        write_json(cout, opt.get_metrics());
+        cout << endl;
+    }
+    //最终的函数值；运行时间；存储元素个数；候选解集的个数
     return make_tuple(fval, runtime_seconds.count(), opt.get_num_elements_stored(), opt.get_num_candidate_solutions());
 }
 
@@ -91,10 +71,21 @@ string to_string(vector<vector<data_t>> const& solution) {
 
 int main() {
     cout << "Reading data" << endl;
-    auto data = read_arff("./KDDCup99/KDDCup99_withoutdupl_norm_1ofn.arff");
+    // All attributes are float, but the id (integer) and the label (nominal). Skip both.
+    DatasetLoaderOptions options;
+    options.exclude = { "id" };
+    string path = "./KDDCup99/KDDCup99_withoutdupl_norm_1ofn.arff";
     //https://www.kaggle.com/isaikumar/creditcardfraud
-    //auto data = read_arff("./Creditcard/test_dim29.arff");
-    cout << "dataset size: " << data.size() << "; dimensions: " << data[0].size() << endl;
+    //string path = "./Creditcard/test_dim29.arff";
+
+    // The first run converts the ARFF file, every further run only maps the binary copy
+    string binary_path = path + (sizeof(data_t) == sizeof(float) ? ".f32.bin" : ".f64.bin");
+    if (!ifstream(binary_path).good()) {
+        convert_arff_to_binary(path, binary_path, options);
+    }
+    MappedDataset dataset(binary_path);
+    DatasetView data = dataset.view();
+    cout << "dataset size: " << data.size() << "; dimensions: " << data.dimension() << endl;
    
 
     vector<idx_t> ids;
@@ -103,7 +94,7 @@ int main() {
     
     unsigned int K = 5;
 
-    FastIVM fastIVM(K, RBFKernel(sqrt(data[0].size()), 1.0), 1.0);
+    FastIVM fastIVM(K, RBFKernel(sqrt(data.dimension()), 1.0), 1.0);
     tuple<data_t, double, unsigned long, unsigned int> res;
 
     cout << "Selecting " << K << " representatives via fast IVM with Greedy" << endl;
@@ -129,27 +120,30 @@ int main() {
     }
     cout << endl;*/
 
+    // All SieveStreaming / SieveStreaming++ configurations consume the data in a single
+    // pass and share the kernel values of the elements they have in common
     auto eps = { 0.01, 0.02, 0.05, 0.1 };
+    FanOut sweep;
+    FastIVM sharedIVM(K, RBFKernel(sqrt(data.dimension()), 1.0), 1.0);
+    sharedIVM.share_kernel_cache(sweep.get_kernel_cache());
     for (auto e : eps) {
-        cout << "Selecting " << K << " representatives via SieveStreaming with eps = " << e << std::endl;
-        SieveStreaming sieve(K, fastIVM, 1.0, e);
-        iota(ids.begin(), ids.end(), 0);
-        res = evaluate_optimizer_ids(sieve, data,  ids);
-        cout << "\t fval:\t\t" << get<0>(res) << "\n\t runtime:\t" << get<1>(res) << "s\n\t memory:\t" << get<2>(res) << "\n\t num_sieves:\t" << get<3>(res) << "\n\n" << endl;
-        
-        /*for (auto x : sieve.get_ids()) {
-            cout << x << ' ';
-        }cout << endl;*/
-
-        iota(ids.begin(), ids.end(), 0);
-        cout << "Selecting " << K << " representatives via SieveStreaming++ with eps = " << e << std::endl;
-        SieveStreamingPP sievepp(K, fastIVM, 1.0, e);
-        res = evaluate_optimizer_ids(sievepp, data, ids);
-        cout << "\t fval:\t\t" << get<0>(res) << "\n\t runtime:\t" << get<1>(res) << "s\n\t memory:\t" << get<2>(res) << "\n\t num_sieves:\t" << get<3>(res) << "\n\n" << endl;
-        /*for (auto x : sievepp.get_ids()) {
-            cout << x << ' ';
-        }cout << endl;*/
+        sweep.emplace<SieveStreaming>(K, sharedIVM, 1.0, e);
+        sweep.emplace<SieveStreamingPP>(K, sharedIVM, 1.0, e);
     }
 
-    
+    iota(ids.begin(), ids.end(), 0);
+    auto start = chrono::steady_clock::now();
+    sweep.fit(data, ids);
+    chrono::duration<double> sweep_seconds = chrono::steady_clock::now() - start;
+    cout << "Ran " << sweep.size() << " configurations in one pass on " << sweep.get_num_threads() << " threads in " << sweep_seconds.count() << "s" << endl;
+
+    size_t i = 0;
+    for (auto e : eps) {
+        for (string name : { "SieveStreaming", "SieveStreaming++" }) {
+            SubmodularOptimizer& opt = sweep[i++];
+            cout << "Selecting " << K << " representatives via " << name << " with eps = " << e << std::endl;
+            cout << "Selected " << opt.get_solution().size() << endl;
+            cout << "\t fval:\t\t" << opt.get_fval() << "\n\t runtime:\t" << sweep_seconds.count() << "s (entire sweep)\n\t memory:\t" << opt.get_num_elements_stored() << "\n\t num_sieves:\t" << opt.get_num_candidate_solutions() << "\n\n" << endl;
+        }
+    }
 }
\ No newline at end of file